@@ -33,32 +33,35 @@ int                    texturedDemoMap[] = {
 };
 
 int main(int argc, char* argv[]) {
-    int             w                        = 800;
-    int             h                        = 600;
-    int             mapWidth                 = 20;
-    int             mapLength                = 20;
-    RaycastColor    fg                       = RED;
-    RaycastColor    bg                       = BLACK;
-    RaycastColor    bg2D                     = WHITE;
-    RaycastColor    wall2D                   = BLUE;
-    SDL_Window*     window                   = NULL;
-    SDL_Renderer*   renderer                 = NULL;
-    Raycaster*      raycaster                = NULL;
-    RaycastTexture* brickTexture             = create_brick_texture(64, 64);
-    RaycastTexture* stoneTexture             = create_stone_texture(64, 64);
-    RaycastTexture* woodTexture              = create_wood_texture(64, 64);
-    RaycastTexture* checkerTexture           = create_checkered_texture(64, 64);
-    int             running                  = 1;
-    int             keys[SDL_SCANCODE_COUNT] = { 0 };
-    int             draw                     = 1;
-    RaycastCamera   camera                   = { .posX   = 11.0f,
-                                                 .posY   = 11.5f,
-                                                 .dirX   = 1.0f,
-                                                 .dirY   = 0.0f,
-                                                 .planeX = 0.0f,
-                                                 .planeY = 0.66f,
-                                                 .fov    = 90 };
-    SDL_Event       event;
+    int                  w                        = 800;
+    int                  h                        = 600;
+    int                  mapWidth                 = 20;
+    int                  mapLength                = 20;
+    RaycastColor         fg                       = RED;
+    RaycastColor         bg                       = BLACK;
+    RaycastColor         bg2D                     = WHITE;
+    RaycastColor         wall2D                   = BLUE;
+    SDL_Window*          window                   = NULL;
+    SDL_Renderer*        renderer                 = NULL;
+    Raycaster*           raycaster                = NULL;
+    RaycastThreadPool*   pool                     = NULL;
+    RaycastPipeline*     pipeline                 = NULL;
+    RaycastTexture*      brickTexture             = create_brick_texture(64, 64);
+    RaycastTexture*      stoneTexture             = create_stone_texture(64, 64);
+    RaycastTexture*      woodTexture              = create_wood_texture(64, 64);
+    RaycastTexture*      checkerTexture           = create_checkered_texture(64, 64);
+    int                  running                  = 1;
+    int                  keys[SDL_SCANCODE_COUNT] = { 0 };
+    int                  draw                     = 1;
+    RaycastCamera        camera                   = { .posX   = 11.0f,
+                                                      .posY   = 11.5f,
+                                                      .dirX   = 1.0f,
+                                                      .dirY   = 0.0f,
+                                                      .planeX = 0.0f,
+                                                      .planeY = 0.66f,
+                                                      .fov    = 90 };
+    RaycastPipelineStats stats;
+    SDL_Event            event;
 
     if (!SDL_Init(SDL_INIT_VIDEO)) {
         fprintf(stderr, "Failed to initialize SDL: %s\n", SDL_GetError());
@@ -86,6 +89,18 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    pool = raycast_thread_pool_create(0);
+    if (!(pipeline = raycast_pipeline_create(raycaster, renderer, pool, w, h))) {
+        fprintf(stderr, "Failed to create frame pipeline\n");
+        raycast_thread_pool_destroy(pool);
+        raycast_destroy(raycaster);
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+    SDL_SetRenderVSync(renderer, 1);
+
     raycaster->textured = 1;
     raycast_add_texture(raycaster, brickTexture); // 0
     raycast_add_texture(raycaster, stoneTexture); // 1
@@ -108,18 +123,28 @@ int main(int argc, char* argv[]) {
         }
         handle_keypresses(keys, &camera, raycaster, &draw);
 
+        // Submit right after sampling input; the worker renders while the last frame presents
         if (draw) {
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            SDL_RenderClear(renderer);
-            raycast_render_textured(raycaster, &camera, renderer, w, h, &bg);
-            raycast_render_2d(raycaster, &camera, renderer, mapWidth, 5.0, &bg2D, &wall2D, &fg);
-            SDL_RenderPresent(renderer);
+            raycast_pipeline_submit(pipeline, &camera, &bg, SDL_GetTicksNS());
             draw = 0;
         }
 
-        SDL_Delay(16);
+        if (raycast_pipeline_draw(pipeline)) {
+            raycast_render_2d(raycaster, &camera, renderer, mapWidth, 5.0, &bg2D, &wall2D, &fg);
+            raycast_pipeline_present(pipeline);
+        } else {
+            SDL_Delay(16);
+        }
     }
 
+    raycast_pipeline_stats(pipeline, &stats);
+    printf("Presented %llu frames, input-to-present latency avg %.2f ms, max %.2f ms\n",
+           (unsigned long long) stats.presented,
+           stats.averageLatency / 1e6,
+           stats.maxLatency / 1e6);
+
+    raycast_pipeline_destroy(pipeline);
+    raycast_thread_pool_destroy(pool);
     raycast_destroy(raycaster);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
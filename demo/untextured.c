@@ -47,10 +47,21 @@ static void demo(int w, int h, int fg, int bg) {
     SDL_Window *window = SDL_CreateWindow("Raycaster Demo", w, h, SDL_WINDOW_RESIZABLE);
     SDL_Renderer *renderer = SDL_CreateRenderer(window, NULL);
     int keys[SDL_SCANCODE_COUNT] = {0};
+    RaycastPipelineStats stats;
 
     Raycaster *raycaster = raycast_init(w, h);
     RaycastCamera camera = {w/10 + 10, h/6+10, 0.0f, 90.0f, 0.0f, 0.0f, 90};
     raycaster->map = expand_map(demoMap, 10, 6, w, h);
+    RaycastPipeline *pipeline = raycast_pipeline_create(raycaster, renderer, NULL, w, h);
+    if (!pipeline) {
+        fprintf(stderr, "Failed to create frame pipeline\n");
+        raycast_destroy(raycaster);
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return;
+    }
+    SDL_SetRenderVSync(renderer, 1);
 
     int running = 1;
     int draw = 1;
@@ -63,24 +74,43 @@ static void demo(int w, int h, int fg, int bg) {
                 keys[event.key.scancode] = 1;
             } else if (event.type == SDL_EVENT_KEY_UP) {
                 keys[event.key.scancode] = 0;
+            } else if (event.type == SDL_EVENT_WINDOW_RESIZED) {
+                // The pipeline's framebuffers are sized at creation, so rebuild it at the new size
+                SDL_GetWindowSize(window, &w, &h);
+                raycast_pipeline_destroy(pipeline);
+                pipeline = raycast_pipeline_create(raycaster, renderer, NULL, w, h);
+                if (!pipeline) {
+                    fprintf(stderr, "Failed to resize frame pipeline\n");
+                    running = 0;
+                    break;
+                }
+                draw = 1;
             }
         }
+        if (!pipeline) {
+            break;
+        }
         handle_keypresses(keys, &camera, raycaster, &draw);
 
         if (draw) {
-            SDL_GetWindowSize(window, &w, &h);
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            SDL_RenderClear(renderer);
-
-            raycast_render(raycaster, &camera, renderer, w, h, &bg);
-            raycast_render_2d(raycaster, &camera, renderer, w, 0.2, &bg, NULL, &fg);
-            SDL_RenderPresent(renderer);
+            raycast_pipeline_submit(pipeline, &camera, &bg, SDL_GetTicksNS());
             draw = 0;
         }
 
-        SDL_Delay(16);
+        if (raycast_pipeline_draw(pipeline)) {
+            raycast_render_2d(raycaster, &camera, renderer, w, 0.2, &bg, NULL, &fg);
+            raycast_pipeline_present(pipeline);
+        } else {
+            SDL_Delay(16);
+        }
     }
 
+    if (pipeline) {
+        raycast_pipeline_stats(pipeline, &stats);
+        printf("Presented %llu frames, input-to-present latency avg %.2f ms, max %.2f ms\n",
+               (unsigned long long) stats.presented, stats.averageLatency / 1e6, stats.maxLatency / 1e6);
+        raycast_pipeline_destroy(pipeline);
+    }
     raycast_destroy(raycaster);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
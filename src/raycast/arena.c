@@ -0,0 +1,71 @@
+#include "raycast.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Create an arena.
+ *
+ * The whole capacity is reserved up front as a single 64-byte aligned block, so everything
+ * allocated from the arena is released by one raycast_arena_destroy() or
+ * raycast_arena_reset() call.
+ *
+ * @param capacity Number of bytes to reserve.
+ * @return The newly allocated arena, or NULL on failure.
+ */
+RaycastArena* raycast_arena_create(size_t capacity) {
+    RaycastArena* arena = (RaycastArena*) calloc(1, sizeof(RaycastArena));
+    if (!arena) {
+        return NULL;
+    }
+
+    capacity = (capacity + RAYCAST_ARENA_ALIGNMENT - 1) & ~(size_t) (RAYCAST_ARENA_ALIGNMENT - 1);
+    arena->base = (uint8_t*) SDL_aligned_alloc(RAYCAST_ARENA_ALIGNMENT, capacity);
+    if (!arena->base) {
+        free(arena);
+        return NULL;
+    }
+
+    arena->capacity = capacity;
+    return arena;
+}
+
+/**
+ * @brief Destroy an arena and everything allocated from it.
+ *
+ * @param arena The arena to destroy.
+ */
+void raycast_arena_destroy(RaycastArena* arena) {
+    if (arena) {
+        SDL_aligned_free(arena->base);
+        free(arena);
+    }
+}
+
+/**
+ * @brief Release everything allocated from an arena while keeping its memory reserved.
+ *
+ * Use this to switch levels without returning memory to the system allocator.
+ *
+ * @param arena The arena to reset.
+ */
+void raycast_arena_reset(RaycastArena* arena) { arena->used = 0; }
+
+/**
+ * @brief Allocate zeroed memory from an arena.
+ *
+ * @param arena The arena to allocate from.
+ * @param size Number of bytes to allocate.
+ * @return Pointer aligned to RAYCAST_ARENA_ALIGNMENT bytes, or NULL if the arena is full.
+ */
+void* raycast_arena_alloc(RaycastArena* arena, size_t size) {
+    size_t offset
+        = (arena->used + RAYCAST_ARENA_ALIGNMENT - 1) & ~(size_t) (RAYCAST_ARENA_ALIGNMENT - 1);
+    if (offset > arena->capacity || size > arena->capacity - offset) {
+        return NULL;
+    }
+
+    arena->used = offset + size;
+    memset(arena->base + offset, 0, size);
+    return arena->base + offset;
+}
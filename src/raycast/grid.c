@@ -0,0 +1,90 @@
+#include "raycast.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Refresh the cached solidity of a rectangle of cells.
+ *
+ * @param grid The grid.
+ * @param x0 First column.
+ * @param y0 First row.
+ * @param x1 One past the last column.
+ * @param y1 One past the last row.
+ */
+static void refresh_cells(RaycastGrid* grid, int x0, int y0, int x1, int y1) {
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            grid->blocked[y * grid->width + x]
+                = raycast_collides(grid->raycaster, x + 0.5f, y + 0.5f);
+        }
+    }
+}
+
+/**
+ * @brief Bring a cached solidity grid up to date with its map.
+ *
+ * Only the cells reported by the edit journal are refreshed; the whole grid is rebuilt if
+ * it was never synced, the journal overflowed or the map was re-initialized.
+ *
+ * @param grid The grid; raycaster must be set, everything else starts zeroed.
+ * @param edits Filled with the refreshed cell rectangles (room for RAYCAST_EDIT_JOURNAL), or
+ *        NULL.
+ * @param count Set to the number of refreshed rectangles, or -1 if the whole grid was
+ *        rebuilt; may be NULL.
+ * @return 0 on success, 1 on allocation failure.
+ */
+int raycast_grid_sync(RaycastGrid* grid, RaycastRect* edits, int* count) {
+    Raycaster*  raycaster = grid->raycaster;
+    RaycastRect journal[RAYCAST_EDIT_JOURNAL];
+    int         edited = raycast_get_edits(raycaster, grid->revision, journal);
+
+    if (grid->blocked && edited >= 0 && grid->width == raycaster->width
+        && grid->height == raycaster->height) {
+        for (int i = 0; i < edited; i++) {
+            refresh_cells(grid,
+                          (int) journal[i].x,
+                          (int) journal[i].y,
+                          (int) (journal[i].x + journal[i].w),
+                          (int) (journal[i].y + journal[i].h));
+        }
+        if (edits) {
+            memcpy(edits, journal, edited * sizeof(RaycastRect));
+        }
+        if (count) {
+            *count = edited;
+        }
+        grid->revision = raycaster->revision;
+        return 0;
+    }
+
+    if (!grid->blocked || grid->width != raycaster->width || grid->height != raycaster->height) {
+        uint8_t* blocked = (uint8_t*) malloc((size_t) raycaster->width * raycaster->height);
+        if (!blocked) {
+            return 1;
+        }
+        free(grid->blocked);
+        grid->blocked = blocked;
+        grid->width   = raycaster->width;
+        grid->height  = raycaster->height;
+    }
+
+    refresh_cells(grid, 0, 0, grid->width, grid->height);
+    if (count) {
+        *count = -1;
+    }
+    grid->revision = raycaster->revision;
+    return 0;
+}
+
+/**
+ * @brief Free the cells of a cached solidity grid.
+ *
+ * @param grid The grid; it can be synced again afterwards.
+ */
+void raycast_grid_free(RaycastGrid* grid) {
+    free(grid->blocked);
+    grid->blocked = NULL;
+    grid->width   = 0;
+    grid->height  = 0;
+}
@@ -0,0 +1,436 @@
+#include "raycast.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC        "RCTX"
+#define CACHE_VERSION      1
+#define CACHE_HEADER_SIZE  (4 + 3 * sizeof(int32_t))
+#define MAX_TEXTURE_PIXELS (8192 * 8192) // Largest texture a file may decode to
+
+/**
+ * @brief Batched texture load job shared by all tasks of raycast_texture_load_set().
+ */
+typedef struct {
+    const char**     paths;
+    RaycastTexture** textures;
+    const char*      cacheDir;
+} LoadSetJob;
+
+/**
+ * @brief Read a whole file into memory.
+ *
+ * @param path Path of the file.
+ * @param size Pointer to store the file size.
+ * @return The file contents (to be freed by the caller), or NULL on failure.
+ */
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    uint8_t* data = NULL;
+    long     end  = -1;
+    if (fseek(file, 0, SEEK_END) == 0 && (end = ftell(file)) >= 0
+        && fseek(file, 0, SEEK_SET) == 0) {
+        data = (uint8_t*) malloc(end > 0 ? end : 1);
+        if (data && fread(data, 1, end, file) != (size_t) end) {
+            free(data);
+            data = NULL;
+        }
+    }
+
+    fclose(file);
+    *size = (size_t) end;
+    return data;
+}
+
+/**
+ * @brief Hash file contents with 64-bit FNV-1a.
+ *
+ * @param data The data to hash.
+ * @param size Number of bytes.
+ * @return The hash.
+ */
+static uint64_t hash_bytes(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Check whether image dimensions read from a file are acceptable for a texture.
+ *
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @return true if both are positive and the pixel count is at most MAX_TEXTURE_PIXELS.
+ */
+static bool texture_size_valid(long width, long height) {
+    return width > 0 && height > 0 && (size_t) width * (size_t) height <= MAX_TEXTURE_PIXELS;
+}
+
+/**
+ * @brief Build the path of the cache entry for a content hash.
+ *
+ * @param cacheDir The cache directory.
+ * @param hash The content hash.
+ * @param path Buffer to store the path.
+ * @param size Size of the buffer.
+ * @return true if the path fits in the buffer, false otherwise.
+ */
+static bool cache_path(const char* cacheDir, uint64_t hash, char* path, size_t size) {
+    int length = snprintf(path,
+                          size,
+                          "%s/%08x%08x.rctx",
+                          cacheDir,
+                          (unsigned) (hash >> 32),
+                          (unsigned) (hash & 0xFFFFFFFFu));
+    return length > 0 && (size_t) length < size;
+}
+
+/**
+ * @brief Load a converted texture from the cache.
+ *
+ * @param path Path of the cache entry.
+ * @return The cached texture, or NULL if there is no valid entry.
+ */
+static RaycastTexture* cache_load(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    char            magic[4];
+    int32_t         header[3];
+    long            end     = -1;
+    RaycastTexture* texture = NULL;
+    if (fread(magic, 1, 4, file) == 4 && memcmp(magic, CACHE_MAGIC, 4) == 0
+        && fread(header, sizeof(int32_t), 3, file) == 3 && header[0] == CACHE_VERSION
+        && texture_size_valid(header[1], header[2]) && fseek(file, 0, SEEK_END) == 0
+        && (end = ftell(file)) >= 0 && fseek(file, CACHE_HEADER_SIZE, SEEK_SET) == 0
+        && (size_t) end == CACHE_HEADER_SIZE + (size_t) header[1] * header[2] * sizeof(RaycastColor)
+        && (texture = raycast_texture_create(header[1], header[2]))) {
+        size_t count = (size_t) header[1] * header[2];
+        if (fread(texture->pixels, sizeof(RaycastColor), count, file) != count) {
+            raycast_texture_destroy(texture);
+            texture = NULL;
+        }
+    }
+
+    fclose(file);
+    return texture;
+}
+
+/**
+ * @brief Store a converted texture in the cache.
+ *
+ * The entry is written to a uniquely named temporary file and renamed into place, so
+ * concurrent loaders, in this process or another, never observe a partial entry.
+ *
+ * @param path Path of the cache entry.
+ * @param texture The texture to store.
+ */
+static void cache_store(const char* path, const RaycastTexture* texture) {
+    char tmpPath[1024];
+    int  length = snprintf(tmpPath, sizeof(tmpPath), "%s.XXXXXX", path);
+    if (length <= 0 || (size_t) length >= sizeof(tmpPath)) {
+        return;
+    }
+
+    int fd = mkstemp(tmpPath);
+    if (fd < 0) {
+        return;
+    }
+    FILE* file = fdopen(fd, "wb");
+    if (!file) {
+        close(fd);
+        remove(tmpPath);
+        return;
+    }
+
+    int32_t header[3] = { CACHE_VERSION, texture->width, texture->height };
+    size_t  count     = (size_t) texture->width * texture->height;
+    bool ok = fwrite(CACHE_MAGIC, 1, 4, file) == 4 && fwrite(header, sizeof(int32_t), 3, file) == 3
+              && fwrite(texture->pixels, sizeof(RaycastColor), count, file) == count;
+
+    if (fclose(file) != 0 || !ok || rename(tmpPath, path) != 0) {
+        remove(tmpPath);
+    }
+}
+
+/**
+ * @brief Skip whitespace and comments in a Netpbm header.
+ *
+ * @param data The file contents.
+ * @param size Number of bytes.
+ * @param pos Current position; updated.
+ */
+static void netpbm_skip(const uint8_t* data, size_t size, size_t* pos) {
+    while (*pos < size) {
+        if (data[*pos] == '#') {
+            while (*pos < size && data[*pos] != '\n') {
+                (*pos)++;
+            }
+        } else if (isspace(data[*pos])) {
+            (*pos)++;
+        } else {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Read an unsigned decimal number from a Netpbm file.
+ *
+ * @param data The file contents.
+ * @param size Number of bytes.
+ * @param pos Current position; updated.
+ * @return The number, or -1 if there is none.
+ */
+static long netpbm_number(const uint8_t* data, size_t size, size_t* pos) {
+    netpbm_skip(data, size, pos);
+    if (*pos >= size || !isdigit(data[*pos])) {
+        return -1;
+    }
+
+    long value = 0;
+    while (*pos < size && isdigit(data[*pos]) && value < 0x1000000) {
+        value = value * 10 + (data[(*pos)++] - '0');
+    }
+    return value;
+}
+
+/**
+ * @brief Read a whitespace-delimited token from a PAM header.
+ *
+ * @param data The file contents.
+ * @param size Number of bytes.
+ * @param pos Current position; updated.
+ * @param token Buffer to store the token.
+ * @param length Size of the buffer.
+ */
+static void pam_token(const uint8_t* data, size_t size, size_t* pos, char* token, size_t length) {
+    size_t n = 0;
+    netpbm_skip(data, size, pos);
+    while (*pos < size && !isspace(data[*pos])) {
+        if (n + 1 < length) {
+            token[n++] = (char) data[*pos];
+        }
+        (*pos)++;
+    }
+    token[n] = '\0';
+}
+
+/**
+ * @brief Decode a PPM (P3/P6), PGM (P2/P5) or PAM (P7) image into a texture.
+ *
+ * @param data The file contents.
+ * @param size Number of bytes.
+ * @return The decoded texture, or NULL if the image is malformed or unsupported.
+ */
+static RaycastTexture* decode_netpbm(const uint8_t* data, size_t size) {
+    size_t pos    = 2;
+    char   type   = (char) data[1];
+    long   width  = -1;
+    long   height = -1;
+    long   depth  = (type == '3' || type == '6') ? 3 : 1;
+    long   maxval = -1;
+
+    if (type == '7') {
+        char token[32];
+        while (true) {
+            pam_token(data, size, &pos, token, sizeof(token));
+            if (!token[0] || strcmp(token, "ENDHDR") == 0) {
+                break;
+            } else if (strcmp(token, "WIDTH") == 0) {
+                width = netpbm_number(data, size, &pos);
+            } else if (strcmp(token, "HEIGHT") == 0) {
+                height = netpbm_number(data, size, &pos);
+            } else if (strcmp(token, "DEPTH") == 0) {
+                depth = netpbm_number(data, size, &pos);
+            } else if (strcmp(token, "MAXVAL") == 0) {
+                maxval = netpbm_number(data, size, &pos);
+            } else if (strcmp(token, "TUPLTYPE") == 0) {
+                pam_token(data, size, &pos, token, sizeof(token));
+            }
+        }
+    } else {
+        width  = netpbm_number(data, size, &pos);
+        height = netpbm_number(data, size, &pos);
+        maxval = netpbm_number(data, size, &pos);
+    }
+
+    if (!texture_size_valid(width, height) || depth < 1 || depth > 4 || maxval <= 0
+        || maxval > 65535 || pos >= size) {
+        return NULL;
+    }
+    pos++; // Single whitespace character before the raster
+
+    // ASCII samples take at least one byte each, binary ones exactly their size
+    bool   ascii  = (type == '2' || type == '3');
+    int    bytes  = (maxval > 255 && !ascii) ? 2 : 1;
+    size_t needed = (size_t) width * height * depth * bytes;
+    if (size - pos < needed) {
+        return NULL;
+    }
+
+    RaycastTexture* texture = raycast_texture_create((int) width, (int) height);
+    if (!texture) {
+        return NULL;
+    }
+
+    for (long i = 0; i < width * height; i++) {
+        int sample[4] = { 0, 0, 0, 255 };
+        for (int c = 0; c < depth; c++) {
+            long value;
+            if (ascii) {
+                value = netpbm_number(data, size, &pos);
+                if (value < 0) {
+                    raycast_texture_destroy(texture);
+                    return NULL;
+                }
+            } else if (bytes == 2) {
+                value = (data[pos] << 8) | data[pos + 1];
+                pos += 2;
+            } else {
+                value = data[pos++];
+            }
+            sample[c] = (int) ((value > maxval ? maxval : value) * 255 / maxval);
+        }
+
+        // Grayscale (with optional alpha) replicates the gray sample into RGB
+        if (depth <= 2) {
+            sample[3] = (depth == 2) ? sample[1] : 255;
+            sample[1] = sample[0];
+            sample[2] = sample[0];
+        }
+
+        texture->pixels[i] = (RaycastColor) (((uint32_t) sample[3] << 24) | (sample[0] << 16)
+                                             | (sample[1] << 8) | sample[2]);
+    }
+
+    return texture;
+}
+
+/**
+ * @brief Decode a BMP image into a texture using SDL.
+ *
+ * @param data The file contents.
+ * @param size Number of bytes.
+ * @return The decoded texture, or NULL on failure.
+ */
+static RaycastTexture* decode_bmp(const uint8_t* data, size_t size) {
+    SDL_Surface* loaded = SDL_LoadBMP_IO(SDL_IOFromConstMem(data, size), true);
+    if (!loaded) {
+        return NULL;
+    }
+
+    SDL_Surface* surface = SDL_ConvertSurface(loaded, SDL_PIXELFORMAT_ARGB8888);
+    SDL_DestroySurface(loaded);
+    if (!surface) {
+        return NULL;
+    }
+
+    RaycastTexture* texture = raycast_texture_create(surface->w, surface->h);
+    if (texture && SDL_LockSurface(surface)) {
+        for (int y = 0; y < surface->h; y++) {
+            memcpy(texture->pixels + y * surface->w,
+                   (const uint8_t*) surface->pixels + y * surface->pitch,
+                   surface->w * sizeof(RaycastColor));
+        }
+        SDL_UnlockSurface(surface);
+    } else {
+        raycast_texture_destroy(texture);
+        texture = NULL;
+    }
+
+    SDL_DestroySurface(surface);
+    return texture;
+}
+
+/**
+ * @brief Load an image file as a texture.
+ *
+ * BMP files are decoded through SDL; PPM, PGM and PAM files are decoded directly. The
+ * format is detected from the file contents. Pixels are converted to the engine's ARGB
+ * layout, and textures with transparent pixels are flagged translucent.
+ *
+ * If cacheDir is given, the converted texture is stored there under the hash of the file
+ * contents, and later loads of an identical file read the converted pixels back instead of
+ * decoding the image again.
+ *
+ * @param path Path of the image file.
+ * @param cacheDir Existing directory for converted textures, or NULL to disable caching.
+ * @return The newly allocated texture, or NULL on failure.
+ */
+RaycastTexture* raycast_texture_load(const char* path, const char* cacheDir) {
+    size_t   size;
+    uint8_t* data = read_file(path, &size);
+    if (!data) {
+        return NULL;
+    }
+
+    char entry[1024];
+    bool cached = cacheDir && cache_path(cacheDir, hash_bytes(data, size), entry, sizeof(entry));
+    RaycastTexture* texture = cached ? cache_load(entry) : NULL;
+
+    if (!texture && size >= 2) {
+        if (data[0] == 'B' && data[1] == 'M') {
+            texture = decode_bmp(data, size);
+        } else if (data[0] == 'P' && data[1] >= '2' && data[1] <= '7' && data[1] != '4') {
+            texture = decode_netpbm(data, size);
+        }
+        if (texture && cached) {
+            cache_store(entry, texture);
+        }
+    }
+
+    free(data);
+    raycast_texture_scan_alpha(texture);
+    return texture;
+}
+
+/**
+ * @brief Load one texture of a batched load job.
+ *
+ * @param data The LoadSetJob.
+ * @param index Index of the texture to load.
+ */
+static void load_set_task(void* data, int index) {
+    LoadSetJob* job      = (LoadSetJob*) data;
+    job->textures[index] = raycast_texture_load(job->paths[index], job->cacheDir);
+}
+
+/**
+ * @brief Load a set of image files as textures in parallel.
+ *
+ * @param paths Array of count image paths.
+ * @param count Number of images.
+ * @param textures Array of count entries to store the textures in (NULL where loading failed).
+ * @param pool The thread pool to decode on, or NULL to decode on the calling thread.
+ * @param cacheDir Existing directory for converted textures, or NULL to disable caching.
+ * @return The number of images that failed to load.
+ */
+int raycast_texture_load_set(const char**       paths,
+                             int                count,
+                             RaycastTexture**   textures,
+                             RaycastThreadPool* pool,
+                             const char*        cacheDir) {
+    LoadSetJob job = { .paths = paths, .textures = textures, .cacheDir = cacheDir };
+    raycast_thread_pool_run(pool, load_set_task, &job, count);
+
+    int failures = 0;
+    for (int i = 0; i < count; i++) {
+        if (!textures[i]) {
+            failures++;
+        }
+    }
+    return failures;
+}
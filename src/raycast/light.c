@@ -0,0 +1,418 @@
+#include "raycast.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief A light slot of a lightmap.
+ *
+ * @param light The light
+ * @param active Whether the slot holds a light (removed slots are reused)
+ */
+typedef struct {
+    RaycastLight light;
+    bool         active;
+} LightSlot;
+
+/**
+ * @struct RaycastLightmap
+ * @brief Light levels of every wall face of a map, relit incrementally.
+ *
+ * The level of a face is the ambient level plus the contribution of every light that can
+ * see the center of the face (the closed part of the panel for thin walls and doors).
+ * Moving a light or editing the map only marks the cells within reach as dirty;
+ * raycast_lightmap_update() relights just those.
+ *
+ * @param raycaster The Raycaster whose map is lit and which renders with the levels
+ * @param lighting Levels and lookup table the renderer reads
+ * @param ambient Level of faces no light reaches
+ * @param lights Light slots
+ * @param lightCount Number of slots in use (active or not)
+ * @param lightCapacity Number of slots allocated
+ * @param dirty One flag per cell whose faces need relighting
+ * @param dirtyTop First row with a dirty cell
+ * @param dirtyBottom One past the last row with a dirty cell
+ * @param revision Edit revision of the map the levels reflect
+ */
+struct RaycastLightmap {
+    Raycaster*      raycaster;
+    RaycastLighting lighting;
+    int             ambient;
+    LightSlot*      lights;
+    int             lightCount;
+    int             lightCapacity;
+    uint8_t*        dirty;
+    int             dirtyTop;
+    int             dirtyBottom;
+    Uint64          revision;
+};
+
+/**
+ * @brief Mark a rectangle of cells for relighting.
+ *
+ * @param lightmap The lightmap.
+ * @param x0 First column.
+ * @param y0 First row.
+ * @param x1 Last column (inclusive).
+ * @param y1 Last row (inclusive).
+ */
+static void mark_dirty(RaycastLightmap* lightmap, int x0, int y0, int x1, int y1) {
+    int width  = lightmap->lighting.width;
+    int height = lightmap->lighting.height;
+    x0         = SDL_max(x0, 0);
+    y0         = SDL_max(y0, 0);
+    x1         = SDL_min(x1, width - 1);
+    y1         = SDL_min(y1, height - 1);
+    if (x0 > x1 || y0 > y1) {
+        return;
+    }
+
+    for (int y = y0; y <= y1; y++) {
+        memset(lightmap->dirty + (size_t) y * width + x0, 1, x1 - x0 + 1);
+    }
+    lightmap->dirtyTop    = SDL_min(lightmap->dirtyTop, y0);
+    lightmap->dirtyBottom = SDL_max(lightmap->dirtyBottom, y1 + 1);
+}
+
+/**
+ * @brief Mark every cell with a face a light may reach.
+ *
+ * @param lightmap The lightmap.
+ * @param light The light.
+ */
+static void mark_light(RaycastLightmap* lightmap, const RaycastLight* light) {
+    mark_dirty(lightmap,
+               (int) floorf(light->x - light->radius) - 1,
+               (int) floorf(light->y - light->radius) - 1,
+               (int) floorf(light->x + light->radius) + 1,
+               (int) floorf(light->y + light->radius) + 1);
+}
+
+/**
+ * @brief Check whether a light reaches the center of a cell face.
+ *
+ * The light casts a ray with the renderer's DDA toward the face center, which is lit if
+ * the ray hits that very face.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param light The light.
+ * @param cell Index of the cell.
+ * @param face The face.
+ * @param faceX The x coordinate of the face center.
+ * @param faceY The y coordinate of the face center.
+ * @param distance Distance from the light to the face center.
+ * @return true if nothing blocks the light.
+ */
+static bool light_reaches(Raycaster*          raycaster,
+                          const RaycastLight* light,
+                          int                 cell,
+                          RaycastFace         face,
+                          float               faceX,
+                          float               faceY,
+                          float               distance) {
+    float      angle = atan2f(faceY - light->y, faceX - light->x) * (180.0f / M_PI);
+    RaycastHit hit;
+    raycast_cast_textured(raycaster, light->x, light->y, angle, &hit);
+    int side = (face == RAYCAST_FACE_WEST || face == RAYCAST_FACE_EAST) ? 0 : 1;
+    return hit.cell == cell && hit.side == side && fabsf(hit.distance - distance) < 0.01f;
+}
+
+/**
+ * @brief Recompute the light levels of the four faces of one cell.
+ *
+ * @param lightmap The lightmap.
+ * @param x The x coordinate of the cell.
+ * @param y The y coordinate of the cell.
+ */
+static void relight_cell(RaycastLightmap* lightmap, int x, int y) {
+    Raycaster* raycaster = lightmap->raycaster;
+    int        cell      = y * raycaster->width + x;
+    int        raw       = raycast_get_cell(raycaster, x, y);
+    int        emptyRaw  = (raycaster->cellBits == 32) ? RAYCAST_EMPTY : RAYCAST_CELL_EMPTY;
+    bool       empty     = (raw == emptyRaw);
+
+    // Face centers, in RaycastFace order
+    float faceX[4] = { (float) x, x + 1.0f, x + 0.5f, x + 0.5f };
+    float faceY[4] = { y + 0.5f, y + 0.5f, (float) y, y + 1.0f };
+
+    // Rays hit a thin wall at the closed part of its panel, so its two sides are lit there
+    const RaycastThinWall* wall = empty ? NULL : raycast_get_thin_wall(raycaster, x, y);
+    if (wall) {
+        float center = (wall->open + 1.0f) / 2.0f;
+        if (wall->orientation == RAYCAST_THIN_VERTICAL) {
+            faceX[RAYCAST_FACE_WEST] = faceX[RAYCAST_FACE_EAST] = x + wall->offset;
+            faceY[RAYCAST_FACE_WEST] = faceY[RAYCAST_FACE_EAST] = y + center;
+        } else {
+            faceX[RAYCAST_FACE_NORTH] = faceX[RAYCAST_FACE_SOUTH] = x + center;
+            faceY[RAYCAST_FACE_NORTH] = faceY[RAYCAST_FACE_SOUTH] = y + wall->offset;
+        }
+    }
+
+    for (int face = 0; face < 4; face++) {
+        int level = lightmap->ambient;
+        for (int i = 0; !empty && i < lightmap->lightCount; i++) {
+            const RaycastLight* light = &lightmap->lights[i].light;
+            if (!lightmap->lights[i].active) {
+                continue;
+            }
+
+            float dx       = faceX[face] - light->x;
+            float dy       = faceY[face] - light->y;
+            bool  outside  = (face == RAYCAST_FACE_WEST)    ? dx > 0.0f
+                             : (face == RAYCAST_FACE_EAST)  ? dx < 0.0f
+                             : (face == RAYCAST_FACE_NORTH) ? dy > 0.0f
+                                                            : dy < 0.0f;
+            float distance = sqrtf(dx * dx + dy * dy);
+            if (!outside || distance >= light->radius) {
+                continue;
+            }
+            if (light_reaches(raycaster,
+                              light,
+                              cell,
+                              (RaycastFace) face,
+                              faceX[face],
+                              faceY[face],
+                              distance)) {
+                level += (int) (light->intensity * (1.0f - distance / light->radius));
+            }
+        }
+        lightmap->lighting.levels[cell * 4 + face] = (uint8_t) SDL_clamp(level, 0, 255);
+    }
+}
+
+/**
+ * @brief Relight the dirty cells of one row.
+ *
+ * @param data The RaycastLightmap.
+ * @param index Offset of the row from the first dirty row.
+ */
+static void relight_row(void* data, int index) {
+    RaycastLightmap* lightmap = (RaycastLightmap*) data;
+    int              width    = lightmap->lighting.width;
+    int              y        = lightmap->dirtyTop + index;
+    uint8_t*         dirty    = lightmap->dirty + (size_t) y * width;
+    for (int x = 0; x < width; x++) {
+        if (dirty[x]) {
+            relight_cell(lightmap, x, y);
+            dirty[x] = 0;
+        }
+    }
+}
+
+/**
+ * @brief (Re)allocate the per-cell arrays for the current map size and mark every cell dirty.
+ *
+ * @param lightmap The lightmap.
+ * @return 0 on success, 1 on allocation failure.
+ */
+static int lightmap_resize(RaycastLightmap* lightmap) {
+    Raycaster* raycaster = lightmap->raycaster;
+    size_t     cells     = (size_t) raycaster->width * raycaster->height;
+
+    if (lightmap->lighting.width != raycaster->width
+        || lightmap->lighting.height != raycaster->height) {
+        // Detach the levels while they do not match the map
+        raycaster->lighting = NULL;
+        free(lightmap->lighting.levels);
+        free(lightmap->dirty);
+        lightmap->lighting.levels = (uint8_t*) malloc(cells * 4);
+        lightmap->dirty           = (uint8_t*) malloc(cells);
+        lightmap->lighting.width  = 0;
+        lightmap->lighting.height = 0;
+        if (!lightmap->lighting.levels || !lightmap->dirty) {
+            return 1;
+        }
+        lightmap->lighting.width  = raycaster->width;
+        lightmap->lighting.height = raycaster->height;
+    }
+
+    lightmap->dirtyTop    = raycaster->height;
+    lightmap->dirtyBottom = 0;
+    mark_dirty(lightmap, 0, 0, raycaster->width - 1, raycaster->height - 1);
+    return 0;
+}
+
+/**
+ * @brief Create a lightmap for a map and attach it to the Raycaster.
+ *
+ * Once attached, raycast_render_buffer(), raycast_render_batch() and
+ * raycast_render_textured() scale the color of every opaque wall by the level of the face
+ * that was hit, through a lookup table. Like the map, the levels must not change while a
+ * frame is being rendered. Snapshot views (raycast_snapshot_acquire) do not share the levels
+ * and render unlit.
+ *
+ * @param raycaster The Raycaster to light.
+ * @param ambient Light level of faces no light reaches, from 0 (black) to 255 (unlit).
+ * @param pool Thread pool to compute the levels with, or NULL.
+ * @return The newly allocated lightmap, or NULL on failure.
+ */
+RaycastLightmap*
+raycast_lightmap_create(Raycaster* raycaster, int ambient, RaycastThreadPool* pool) {
+    if (!raycaster || raycaster->width <= 0 || raycaster->height <= 0) {
+        return NULL;
+    }
+
+    RaycastLightmap* lightmap = (RaycastLightmap*) calloc(1, sizeof(RaycastLightmap));
+    if (!lightmap) {
+        return NULL;
+    }
+
+    lightmap->raycaster = raycaster;
+    lightmap->ambient   = SDL_clamp(ambient, 0, 255);
+    lightmap->revision  = raycaster->revision;
+    for (int level = 0; level < 256; level++) {
+        for (int value = 0; value < 256; value++) {
+            lightmap->lighting.table[level][value] = (uint8_t) ((value * level + 127) / 255);
+        }
+    }
+
+    if (lightmap_resize(lightmap) || raycast_lightmap_update(lightmap, pool)) {
+        raycast_lightmap_destroy(lightmap);
+        return NULL;
+    }
+    return lightmap;
+}
+
+/**
+ * @brief Detach a lightmap from its Raycaster and free it.
+ *
+ * @param lightmap The lightmap to destroy.
+ */
+void raycast_lightmap_destroy(RaycastLightmap* lightmap) {
+    if (!lightmap) {
+        return;
+    }
+
+    if (lightmap->raycaster->lighting == &lightmap->lighting) {
+        lightmap->raycaster->lighting = NULL;
+    }
+    free(lightmap->lighting.levels);
+    free(lightmap->dirty);
+    free(lightmap->lights);
+    free(lightmap);
+}
+
+/**
+ * @brief Add a light to a lightmap.
+ *
+ * The light takes effect at the next raycast_lightmap_update().
+ *
+ * @param lightmap The lightmap.
+ * @param light The light.
+ * @return The ID of the light, or -1 on allocation failure.
+ */
+int raycast_lightmap_add_light(RaycastLightmap* lightmap, const RaycastLight* light) {
+    int id = 0;
+    while (id < lightmap->lightCount && lightmap->lights[id].active) {
+        id++;
+    }
+
+    if (id == lightmap->lightCapacity) {
+        int        capacity = (lightmap->lightCapacity > 0) ? lightmap->lightCapacity * 2 : 8;
+        LightSlot* lights   = (LightSlot*) realloc(lightmap->lights, capacity * sizeof(LightSlot));
+        if (!lights) {
+            return -1;
+        }
+        lightmap->lights        = lights;
+        lightmap->lightCapacity = capacity;
+    }
+
+    lightmap->lights[id] = (LightSlot){ .light = *light, .active = true };
+    if (id == lightmap->lightCount) {
+        lightmap->lightCount++;
+    }
+    mark_light(lightmap, light);
+    return id;
+}
+
+/**
+ * @brief Move or change a light of a lightmap.
+ *
+ * Only the cells within reach of the old and the new light are relit at the next
+ * raycast_lightmap_update().
+ *
+ * @param lightmap The lightmap.
+ * @param id The ID of the light.
+ * @param light The new position, radius and intensity of the light.
+ */
+void raycast_lightmap_set_light(RaycastLightmap* lightmap, int id, const RaycastLight* light) {
+    if (id < 0 || id >= lightmap->lightCount || !lightmap->lights[id].active) {
+        return;
+    }
+    mark_light(lightmap, &lightmap->lights[id].light);
+    lightmap->lights[id].light = *light;
+    mark_light(lightmap, light);
+}
+
+/**
+ * @brief Remove a light from a lightmap.
+ *
+ * @param lightmap The lightmap.
+ * @param id The ID of the light.
+ */
+void raycast_lightmap_remove_light(RaycastLightmap* lightmap, int id) {
+    if (id < 0 || id >= lightmap->lightCount || !lightmap->lights[id].active) {
+        return;
+    }
+    mark_light(lightmap, &lightmap->lights[id].light);
+    lightmap->lights[id].active = false;
+}
+
+/**
+ * @brief Relight the faces affected by light changes and map edits since the last update.
+ *
+ * An edited cell is relit together with its neighbours, and with everything within reach
+ * of the lights whose area it lies in, since it may now cast or stop casting a shadow.
+ * Doors count as edited once raycast_mark_cell() reports a change of their open field.
+ * If the edit journal overflowed or the map was reinitialized, every face is relit.
+ *
+ * @param lightmap The lightmap.
+ * @param pool Thread pool to spread the dirty rows over, or NULL.
+ * @return 0 on success, 1 on allocation failure (the lightmap is detached until an update
+ *         succeeds).
+ */
+int raycast_lightmap_update(RaycastLightmap* lightmap, RaycastThreadPool* pool) {
+    Raycaster*  raycaster = lightmap->raycaster;
+    RaycastRect edits[RAYCAST_EDIT_JOURNAL];
+    int         editCount = raycast_get_edits(raycaster, lightmap->revision, edits);
+
+    if (editCount < 0 || lightmap->lighting.width != raycaster->width
+        || lightmap->lighting.height != raycaster->height || !lightmap->lighting.levels) {
+        if (lightmap_resize(lightmap)) {
+            return 1;
+        }
+        editCount = 0;
+    }
+
+    for (int i = 0; i < editCount; i++) {
+        int x0 = (int) edits[i].x;
+        int y0 = (int) edits[i].y;
+        int x1 = x0 + (int) edits[i].w - 1;
+        int y1 = y0 + (int) edits[i].h - 1;
+        mark_dirty(lightmap, x0 - 1, y0 - 1, x1 + 1, y1 + 1);
+
+        for (int l = 0; l < lightmap->lightCount; l++) {
+            const RaycastLight* light = &lightmap->lights[l].light;
+            if (lightmap->lights[l].active && light->x + light->radius >= x0
+                && light->x - light->radius <= x1 + 1 && light->y + light->radius >= y0
+                && light->y - light->radius <= y1 + 1) {
+                mark_light(lightmap, light);
+            }
+        }
+    }
+    lightmap->revision = raycaster->revision;
+
+    if (lightmap->dirtyBottom > lightmap->dirtyTop) {
+        raycast_thread_pool_run(pool,
+                                relight_row,
+                                lightmap,
+                                lightmap->dirtyBottom - lightmap->dirtyTop);
+    }
+    lightmap->dirtyTop    = raycaster->height;
+    lightmap->dirtyBottom = 0;
+
+    raycaster->lighting   = &lightmap->lighting;
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include "raycast.h"
+
+#include <math.h>
+#include <stdbool.h>
+
+#define MOVE_CHUNK     256 // Bodies moved by one task of raycast_move_bodies()
+#define MOVE_MAX_STEPS 256 // Substeps a body is moved in at most, whatever its speed
+
+/**
+ * @brief Batched movement job shared by all tasks of raycast_move_bodies().
+ */
+typedef struct {
+    Raycaster*           raycaster;
+    const RaycastBodies* bodies;
+    float                dt;
+} MoveJob;
+
+/**
+ * @brief Push a circle out of the solid cells it overlaps and slide its velocity along them.
+ *
+ * Cells are visited in row-major order, so the result only depends on the body itself. A
+ * center more than a cell outside the map is first moved back to one cell outside it.
+ *
+ * @param raycaster The Raycaster whose map to collide with.
+ * @param x The x coordinate of the center; updated.
+ * @param y The y coordinate of the center; updated.
+ * @param vx The x velocity; its component into any wall touched is removed.
+ * @param vy The y velocity; its component into any wall touched is removed.
+ * @param radius The radius of the circle.
+ */
+static void
+resolve_body(Raycaster* raycaster, float* x, float* y, float* vx, float* vy, float radius) {
+    // Everything outside the map is solid, so a body flung beyond it is kept just outside; that
+    // also keeps the cell coordinates below in int range
+    *x     = SDL_clamp(*x, -1.0f, raycaster->width + 1.0f);
+    *y     = SDL_clamp(*y, -1.0f, raycaster->height + 1.0f);
+
+    int x0 = (int) floorf(*x - radius);
+    int x1 = (int) floorf(*x + radius);
+    int y0 = (int) floorf(*y - radius);
+    int y1 = (int) floorf(*y + radius);
+
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            if (!raycast_collides(raycaster, cx + 0.5f, cy + 0.5f)) {
+                continue;
+            }
+
+            // Closest point of the cell to the center
+            float ox       = *x - SDL_clamp(*x, (float) cx, (float) cx + 1.0f);
+            float oy       = *y - SDL_clamp(*y, (float) cy, (float) cy + 1.0f);
+            float distance = ox * ox + oy * oy;
+            if (distance >= radius * radius) {
+                continue;
+            }
+
+            float nx;
+            float ny;
+            float push;
+            if (distance > 0.0f) {
+                distance = sqrtf(distance);
+                nx       = ox / distance;
+                ny       = oy / distance;
+                push     = radius - distance;
+            } else {
+                // The center is inside the cell: leave through the nearest edge to a free cell
+                float edges[4]   = { *x - cx, cx + 1.0f - *x, *y - cy, cy + 1.0f - *y };
+                int   offsets[4] = { -1, 1, -1, 1 };
+                int   best       = -1;
+                for (int e = 0; e < 4; e++) {
+                    int  ex   = cx + ((e < 2) ? offsets[e] : 0);
+                    int  ey   = cy + ((e < 2) ? 0 : offsets[e]);
+                    bool open = !raycast_collides(raycaster, ex + 0.5f, ey + 0.5f);
+                    if (open && (best < 0 || edges[e] < edges[best])) {
+                        best = e;
+                    }
+                }
+                if (best < 0) {
+                    // Buried in solid cells: there is no way out to slide along
+                    continue;
+                }
+                nx   = (best < 2) ? (float) offsets[best] : 0.0f;
+                ny   = (best < 2) ? 0.0f : (float) offsets[best];
+                push = edges[best] + radius;
+            }
+
+            *x += nx * push;
+            *y += ny * push;
+
+            float into = *vx * nx + *vy * ny;
+            if (into < 0.0f) {
+                *vx -= into * nx;
+                *vy -= into * ny;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Move one body by its velocity, sliding along the walls it runs into.
+ *
+ * The move is split into substeps of at most half the radius (and at most a quarter cell),
+ * so a body never tunnels through a wall, and each substep uses the velocity left after the
+ * previous collisions. A body is moved in at most MOVE_MAX_STEPS substeps, so one that
+ * covers more than that many substeps in a single move may pass through thin walls. A body
+ * with a non-finite position, velocity or radius is left untouched.
+ *
+ * @param raycaster The Raycaster whose map to collide with.
+ * @param bodies The bodies.
+ * @param index Index of the body to move.
+ * @param dt The time step.
+ */
+static void move_body(Raycaster* raycaster, const RaycastBodies* bodies, int index, float dt) {
+    float x      = bodies->x[index];
+    float y      = bodies->y[index];
+    float vx     = bodies->vx[index];
+    float vy     = bodies->vy[index];
+    float radius = bodies->radius[index];
+    if (!isfinite(x) || !isfinite(y) || !isfinite(vx) || !isfinite(vy) || !isfinite(radius)) {
+        return;
+    }
+
+    float step   = SDL_clamp(radius * 0.5f, 0.01f, 0.25f);
+    float reach  = SDL_max(fabsf(vx), fabsf(vy)) * dt;
+    int   steps  = 1;
+    float stepDt = dt;
+    if (reach > step) {
+        // Compare as floats so a huge reach never reaches the int conversion
+        float needed = ceilf(reach / step);
+        steps        = (needed < MOVE_MAX_STEPS) ? (int) needed : MOVE_MAX_STEPS;
+        stepDt       = dt / steps;
+    }
+
+    resolve_body(raycaster, &x, &y, &vx, &vy, radius);
+    for (int i = 0; i < steps; i++) {
+        x += vx * stepDt;
+        y += vy * stepDt;
+        resolve_body(raycaster, &x, &y, &vx, &vy, radius);
+    }
+
+    bodies->x[index]  = x;
+    bodies->y[index]  = y;
+    bodies->vx[index] = vx;
+    bodies->vy[index] = vy;
+}
+
+/**
+ * @brief Move one chunk of bodies.
+ *
+ * @param data The MoveJob.
+ * @param index Index of the chunk.
+ */
+static void move_bodies_task(void* data, int index) {
+    MoveJob* job   = (MoveJob*) data;
+    int      first = index * MOVE_CHUNK;
+    int      last  = SDL_min(first + MOVE_CHUNK, job->bodies->count);
+    for (int i = first; i < last; i++) {
+        move_body(job->raycaster, job->bodies, i, job->dt);
+    }
+}
+
+/**
+ * @brief Move a batch of circular bodies through the map with swept collision and sliding.
+ *
+ * Every body moves by its velocity times dt as a circle of its radius. Cells for which
+ * raycast_collides() is true, and everything outside the map, are solid. On contact the body
+ * slides along the wall and the velocity component into the wall is removed. Bodies do not
+ * collide with each other, so each result is identical to moving that body alone, whatever
+ * the batch size or the number of threads. Each body is moved in at most a bounded number of
+ * substeps; bodies with a non-finite position, velocity or radius, or every body if dt is not
+ * finite, are left untouched.
+ *
+ * @param raycaster The Raycaster whose map to collide with.
+ * @param bodies The bodies; positions and velocities are updated in place.
+ * @param dt The time step.
+ * @param pool Thread pool to spread the bodies over, or NULL to move them on the calling thread.
+ */
+void raycast_move_bodies(Raycaster*           raycaster,
+                         const RaycastBodies* bodies,
+                         float                dt,
+                         RaycastThreadPool*   pool) {
+    if (!raycaster || !bodies || bodies->count <= 0 || !isfinite(dt)) {
+        return;
+    }
+
+    MoveJob job    = { .raycaster = raycaster, .bodies = bodies, .dt = dt };
+    int     chunks = (bodies->count + MOVE_CHUNK - 1) / MOVE_CHUNK;
+    raycast_thread_pool_run(pool, move_bodies_task, &job, chunks);
+}
@@ -0,0 +1,579 @@
+#include "raycast.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PATH_STRAIGHT 10 // Cost of one orthogonal step
+#define PATH_DIAGONAL 14 // Cost of one diagonal step
+
+/**
+ * @brief Reusable search state of one thread.
+ *
+ * Nodes are valid for the current query only if their generation matches, so the arrays
+ * never have to be cleared between queries.
+ *
+ * @param generation Generation of the current query
+ * @param generations Generation each node was last touched in
+ * @param g Cost from the start to each node
+ * @param f Estimated total cost through each node
+ * @param parent Jump point each node was reached from
+ * @param heapIndex Position of each node in the open heap, or -1 once closed
+ * @param heap Open list as a binary min-heap of node indices
+ * @param heapSize Number of nodes in the open heap
+ */
+typedef struct {
+    Uint32  generation;
+    Uint32* generations;
+    int*    g;
+    int*    f;
+    int*    parent;
+    int*    heapIndex;
+    int*    heap;
+    int     heapSize;
+} PathSearch;
+
+/**
+ * @struct RaycastPathfinder
+ * @brief Jump Point Search over the walkable cells of a Raycaster map.
+ *
+ * @param grid Cached walkability of the cells of the searched map
+ * @param searches Search states, one per thread of the largest batch so far
+ * @param searchCount Number of search states
+ */
+struct RaycastPathfinder {
+    RaycastGrid grid;
+    PathSearch* searches;
+    int         searchCount;
+};
+
+/**
+ * @brief Batched query job shared by all tasks of raycast_find_paths().
+ */
+typedef struct {
+    RaycastPathfinder* pathfinder;
+    RaycastPathQuery*  queries;
+    int                count;
+    SDL_AtomicInt      next;
+} PathBatchJob;
+
+/**
+ * @brief Check whether a cell can be entered.
+ *
+ * @param pathfinder The pathfinder.
+ * @param x The x coordinate of the cell.
+ * @param y The y coordinate of the cell.
+ * @return true if the cell is inside the map and not solid.
+ */
+static inline bool walkable(const RaycastPathfinder* pathfinder, int x, int y) {
+    return x >= 0 && x < pathfinder->grid.width && y >= 0 && y < pathfinder->grid.height
+           && !pathfinder->grid.blocked[y * pathfinder->grid.width + x];
+}
+
+/**
+ * @brief Estimate the cost between two cells with the octile distance.
+ *
+ * @param dx Distance along x.
+ * @param dy Distance along y.
+ * @return The cost of the shortest 8-connected path on an empty grid.
+ */
+static inline int octile(int dx, int dy) {
+    dx = abs(dx);
+    dy = abs(dy);
+    return (dx < dy) ? PATH_DIAGONAL * dx + PATH_STRAIGHT * (dy - dx)
+                     : PATH_DIAGONAL * dy + PATH_STRAIGHT * (dx - dy);
+}
+
+/**
+ * @brief Free the arrays of a search state.
+ *
+ * @param search The search state.
+ */
+static void search_free(PathSearch* search) {
+    free(search->generations);
+    free(search->g);
+    free(search->f);
+    free(search->parent);
+    free(search->heapIndex);
+    free(search->heap);
+}
+
+/**
+ * @brief Free every search state of a pathfinder.
+ *
+ * @param pathfinder The pathfinder.
+ */
+static void free_searches(RaycastPathfinder* pathfinder) {
+    for (int i = 0; i < pathfinder->searchCount; i++) {
+        search_free(&pathfinder->searches[i]);
+    }
+    free(pathfinder->searches);
+    pathfinder->searches    = NULL;
+    pathfinder->searchCount = 0;
+}
+
+/**
+ * @brief Bring the cached walkability grid up to date with the map.
+ *
+ * Search states are sized to the grid, so they are dropped when the map was re-initialized
+ * with another size.
+ *
+ * @param pathfinder The pathfinder.
+ * @return 0 on success, 1 on allocation failure.
+ */
+static int sync_grid(RaycastPathfinder* pathfinder) {
+    RaycastGrid* grid = &pathfinder->grid;
+    if (grid->width != grid->raycaster->width || grid->height != grid->raycaster->height) {
+        free_searches(pathfinder);
+    }
+    return raycast_grid_sync(grid, NULL, NULL);
+}
+
+/**
+ * @brief Make sure a pathfinder has at least one search state per thread.
+ *
+ * @param pathfinder The pathfinder.
+ * @param count Number of search states needed.
+ * @return 0 on success, 1 on allocation failure.
+ */
+static int reserve_searches(RaycastPathfinder* pathfinder, int count) {
+    if (count <= pathfinder->searchCount) {
+        return 0;
+    }
+
+    PathSearch* searches = (PathSearch*) realloc(pathfinder->searches, count * sizeof(PathSearch));
+    if (!searches) {
+        return 1;
+    }
+    pathfinder->searches = searches;
+
+    size_t cells         = (size_t) pathfinder->grid.width * pathfinder->grid.height;
+    while (pathfinder->searchCount < count) {
+        PathSearch* search  = &searches[pathfinder->searchCount];
+        search->generation  = 0;
+        search->heapSize    = 0;
+        search->generations = (Uint32*) calloc(cells, sizeof(Uint32));
+        search->g           = (int*) malloc(cells * sizeof(int));
+        search->f           = (int*) malloc(cells * sizeof(int));
+        search->parent      = (int*) malloc(cells * sizeof(int));
+        search->heapIndex   = (int*) malloc(cells * sizeof(int));
+        search->heap        = (int*) malloc(cells * sizeof(int));
+        if (!search->generations || !search->g || !search->f || !search->parent
+            || !search->heapIndex || !search->heap) {
+            search_free(search);
+            return 1;
+        }
+        pathfinder->searchCount++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Order two open nodes: lower f first, then higher g, then lower index.
+ *
+ * @param search The search state.
+ * @param a First node.
+ * @param b Second node.
+ * @return true if a should be expanded before b.
+ */
+static inline bool heap_less(const PathSearch* search, int a, int b) {
+    if (search->f[a] != search->f[b]) {
+        return search->f[a] < search->f[b];
+    }
+    if (search->g[a] != search->g[b]) {
+        return search->g[a] > search->g[b];
+    }
+    return a < b;
+}
+
+/**
+ * @brief Move a node toward the root of the open heap until the heap order holds.
+ *
+ * @param search The search state.
+ * @param position Position of the node in the heap.
+ */
+static void heap_up(PathSearch* search, int position) {
+    int node = search->heap[position];
+    while (position > 0) {
+        int parent = (position - 1) / 2;
+        if (!heap_less(search, node, search->heap[parent])) {
+            break;
+        }
+        search->heap[position]                    = search->heap[parent];
+        search->heapIndex[search->heap[position]] = position;
+        position                                  = parent;
+    }
+    search->heap[position]  = node;
+    search->heapIndex[node] = position;
+}
+
+/**
+ * @brief Remove and return the best node of the open heap.
+ *
+ * @param search The search state.
+ * @return The node with the lowest f.
+ */
+static int heap_pop(PathSearch* search) {
+    int top      = search->heap[0];
+    int node     = search->heap[--search->heapSize];
+    int size     = search->heapSize;
+    int position = 0;
+
+    while (size > 0) {
+        int child = position * 2 + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && heap_less(search, search->heap[child + 1], search->heap[child])) {
+            child++;
+        }
+        if (!heap_less(search, search->heap[child], node)) {
+            break;
+        }
+        search->heap[position]                    = search->heap[child];
+        search->heapIndex[search->heap[position]] = position;
+        position                                  = child;
+    }
+    if (size > 0) {
+        search->heap[position]  = node;
+        search->heapIndex[node] = position;
+    }
+
+    search->heapIndex[top] = -1;
+    return top;
+}
+
+/**
+ * @brief Follow a straight line until it reaches the goal, a wall or a jump point.
+ *
+ * Jump points are cells with a forced neighbor: a side cell that is open while the cell
+ * beside it one step back is blocked. Diagonal moves may not cut corners.
+ *
+ * @param pathfinder The pathfinder.
+ * @param x The x coordinate of the first cell to visit.
+ * @param y The y coordinate of the first cell to visit.
+ * @param dx Step along x.
+ * @param dy Step along y.
+ * @param goal Index of the goal cell.
+ * @return Index of the jump point found, or -1 if there is none.
+ */
+static int jump(const RaycastPathfinder* pathfinder, int x, int y, int dx, int dy, int goal) {
+    int width = pathfinder->grid.width;
+    while (walkable(pathfinder, x, y)) {
+        if (y * width + x == goal) {
+            return goal;
+        }
+
+        if (dx != 0 && dy != 0) {
+            if (jump(pathfinder, x + dx, y, dx, 0, goal) >= 0
+                || jump(pathfinder, x, y + dy, 0, dy, goal) >= 0) {
+                return y * width + x;
+            }
+            if (!walkable(pathfinder, x + dx, y) || !walkable(pathfinder, x, y + dy)) {
+                return -1;
+            }
+        } else if (dx != 0) {
+            if ((walkable(pathfinder, x, y - 1) && !walkable(pathfinder, x - dx, y - 1))
+                || (walkable(pathfinder, x, y + 1) && !walkable(pathfinder, x - dx, y + 1))) {
+                return y * width + x;
+            }
+        } else {
+            if ((walkable(pathfinder, x - 1, y) && !walkable(pathfinder, x - 1, y - dy))
+                || (walkable(pathfinder, x + 1, y) && !walkable(pathfinder, x + 1, y - dy))) {
+                return y * width + x;
+            }
+        }
+
+        x += dx;
+        y += dy;
+    }
+    return -1;
+}
+
+/**
+ * @brief Add the jump point reached in one direction to the open list.
+ *
+ * @param pathfinder The pathfinder.
+ * @param search The search state.
+ * @param node The node being expanded.
+ * @param dx Step along x.
+ * @param dy Step along y.
+ * @param goal Index of the goal cell.
+ */
+static void expand(
+    const RaycastPathfinder* pathfinder, PathSearch* search, int node, int dx, int dy, int goal) {
+    int width = pathfinder->grid.width;
+    int x     = node % width;
+    int y     = node / width;
+    int found = jump(pathfinder, x + dx, y + dy, dx, dy, goal);
+    if (found < 0) {
+        return;
+    }
+
+    int fx = found % width;
+    int fy = found / width;
+    int g  = search->g[node] + octile(fx - x, fy - y);
+
+    if (search->generations[found] != search->generation) {
+        search->generations[found]       = search->generation;
+        search->heapIndex[found]         = search->heapSize;
+        search->heap[search->heapSize++] = found;
+    } else if (search->heapIndex[found] < 0 || g >= search->g[found]) {
+        return;
+    }
+
+    search->g[found]      = g;
+    search->f[found]      = g + octile(goal % width - fx, goal / width - fy);
+    search->parent[found] = node;
+    heap_up(search, search->heapIndex[found]);
+}
+
+/**
+ * @brief Answer one path query with the given search state.
+ *
+ * @param pathfinder The pathfinder, with an up to date grid.
+ * @param search The search state to use.
+ * @param query The query to answer.
+ */
+static void
+find_path(const RaycastPathfinder* pathfinder, PathSearch* search, RaycastPathQuery* query) {
+    int width     = pathfinder->grid.width;
+    query->length = 0;
+    if (!walkable(pathfinder, query->startX, query->startY)
+        || !walkable(pathfinder, query->goalX, query->goalY)) {
+        return;
+    }
+
+    if (++search->generation == 0) {
+        memset(search->generations, 0, (size_t) width * pathfinder->grid.height * sizeof(Uint32));
+        search->generation = 1;
+    }
+
+    int start                  = query->startY * width + query->startX;
+    int goal                   = query->goalY * width + query->goalX;
+
+    search->heapSize           = 0;
+    search->generations[start] = search->generation;
+    search->g[start]           = 0;
+    search->f[start]           = octile(query->goalX - query->startX, query->goalY - query->startY);
+    search->parent[start]      = -1;
+    search->heapIndex[start]   = 0;
+    search->heap[search->heapSize++] = start;
+
+    while (search->heapSize > 0) {
+        int node = heap_pop(search);
+        if (node == goal) {
+            break;
+        }
+
+        int x      = node % width;
+        int y      = node / width;
+        int parent = search->parent[node];
+        if (parent < 0) {
+            // The start has no direction yet: try every move that does not cut a corner
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    if ((dx || dy)
+                        && (!dx || !dy
+                            || (walkable(pathfinder, x + dx, y)
+                                && walkable(pathfinder, x, y + dy)))) {
+                        expand(pathfinder, search, node, dx, dy, goal);
+                    }
+                }
+            }
+            continue;
+        }
+
+        // Only the natural and forced neighbors of the direction of travel are searched
+        int dx = (x > parent % width) - (x < parent % width);
+        int dy = (y > parent / width) - (y < parent / width);
+        if (dx != 0 && dy != 0) {
+            bool openX = walkable(pathfinder, x + dx, y);
+            bool openY = walkable(pathfinder, x, y + dy);
+            if (openY) {
+                expand(pathfinder, search, node, 0, dy, goal);
+            }
+            if (openX) {
+                expand(pathfinder, search, node, dx, 0, goal);
+            }
+            if (openX && openY) {
+                expand(pathfinder, search, node, dx, dy, goal);
+            }
+        } else if (dx != 0) {
+            bool openAhead = walkable(pathfinder, x + dx, y);
+            bool openDown  = walkable(pathfinder, x, y + 1);
+            bool openUp    = walkable(pathfinder, x, y - 1);
+            if (openAhead) {
+                expand(pathfinder, search, node, dx, 0, goal);
+                if (openDown) {
+                    expand(pathfinder, search, node, dx, 1, goal);
+                }
+                if (openUp) {
+                    expand(pathfinder, search, node, dx, -1, goal);
+                }
+            }
+            if (openDown) {
+                expand(pathfinder, search, node, 0, 1, goal);
+            }
+            if (openUp) {
+                expand(pathfinder, search, node, 0, -1, goal);
+            }
+        } else {
+            bool openAhead = walkable(pathfinder, x, y + dy);
+            bool openRight = walkable(pathfinder, x + 1, y);
+            bool openLeft  = walkable(pathfinder, x - 1, y);
+            if (openAhead) {
+                expand(pathfinder, search, node, 0, dy, goal);
+                if (openRight) {
+                    expand(pathfinder, search, node, 1, dy, goal);
+                }
+                if (openLeft) {
+                    expand(pathfinder, search, node, -1, dy, goal);
+                }
+            }
+            if (openRight) {
+                expand(pathfinder, search, node, 1, 0, goal);
+            }
+            if (openLeft) {
+                expand(pathfinder, search, node, -1, 0, goal);
+            }
+        }
+    }
+
+    if (search->generations[goal] != search->generation || search->heapIndex[goal] >= 0) {
+        return;
+    }
+
+    int length = 0;
+    for (int node = goal; node >= 0; node = search->parent[node]) {
+        length++;
+    }
+    int position = length;
+    for (int node = goal; node >= 0; node = search->parent[node]) {
+        if (--position < query->capacity) {
+            query->path[position * 2]     = node % width;
+            query->path[position * 2 + 1] = node / width;
+        }
+    }
+    query->length = length;
+}
+
+/**
+ * @brief Answer queries of a batch on one thread.
+ *
+ * @param data The PathBatchJob.
+ * @param index Index of the search state to use.
+ */
+static void find_paths_task(void* data, int index) {
+    PathBatchJob* job    = (PathBatchJob*) data;
+    PathSearch*   search = &job->pathfinder->searches[index];
+    int           query;
+    while ((query = SDL_AddAtomicInt(&job->next, 1)) < job->count) {
+        find_path(job->pathfinder, search, &job->queries[query]);
+    }
+}
+
+/**
+ * @brief Create a pathfinder for the cells of a Raycaster map.
+ *
+ * A cell is walkable if raycast_collides() is false at its center. The pathfinder caches
+ * that for every cell and catches up with raycast_draw() / raycast_erase() edits through
+ * the edit journal before each search.
+ *
+ * @param raycaster The Raycaster whose map to search.
+ * @return The newly allocated pathfinder, or NULL on failure.
+ */
+RaycastPathfinder* raycast_pathfinder_create(Raycaster* raycaster) {
+    if (!raycaster) {
+        return NULL;
+    }
+
+    RaycastPathfinder* pathfinder = (RaycastPathfinder*) calloc(1, sizeof(RaycastPathfinder));
+    if (!pathfinder) {
+        return NULL;
+    }
+
+    pathfinder->grid.raycaster = raycaster;
+    if (sync_grid(pathfinder) || reserve_searches(pathfinder, 1)) {
+        raycast_pathfinder_destroy(pathfinder);
+        return NULL;
+    }
+
+    return pathfinder;
+}
+
+/**
+ * @brief Free a pathfinder and its search states.
+ *
+ * @param pathfinder The pathfinder to destroy.
+ */
+void raycast_pathfinder_destroy(RaycastPathfinder* pathfinder) {
+    if (!pathfinder) {
+        return;
+    }
+
+    free_searches(pathfinder);
+    raycast_grid_free(&pathfinder->grid);
+    free(pathfinder);
+}
+
+/**
+ * @brief Find the shortest 8-connected path between two cells with Jump Point Search.
+ *
+ * The path is returned as jump points: consecutive waypoints are joined by a straight or
+ * 45 degree line of walkable cells, and diagonal steps never cut a blocked corner.
+ *
+ * @param pathfinder The pathfinder.
+ * @param startX The x coordinate of the start cell.
+ * @param startY The y coordinate of the start cell.
+ * @param goalX The x coordinate of the goal cell.
+ * @param goalY The y coordinate of the goal cell.
+ * @param path Filled with x, y pairs of the waypoints from start to goal.
+ * @param capacity Number of waypoints path has room for.
+ * @return The number of waypoints of the path (only the first capacity are stored), or 0 if
+ *         the goal cannot be reached.
+ */
+int raycast_find_path(RaycastPathfinder* pathfinder,
+                      int                startX,
+                      int                startY,
+                      int                goalX,
+                      int                goalY,
+                      int*               path,
+                      int                capacity) {
+    RaycastPathQuery query = { .startX   = startX,
+                               .startY   = startY,
+                               .goalX    = goalX,
+                               .goalY    = goalY,
+                               .path     = path,
+                               .capacity = capacity };
+    raycast_find_paths(pathfinder, &query, 1, NULL);
+    return query.length;
+}
+
+/**
+ * @brief Answer a batch of path queries, spread over a thread pool.
+ *
+ * Every thread searches with its own reusable search state, so results are identical to
+ * answering the queries one by one.
+ *
+ * @param pathfinder The pathfinder.
+ * @param queries The queries; length is filled in as by raycast_find_path().
+ * @param count Number of queries.
+ * @param pool Thread pool to search with, or NULL to search on the calling thread.
+ */
+void raycast_find_paths(RaycastPathfinder* pathfinder,
+                        RaycastPathQuery*  queries,
+                        int                count,
+                        RaycastThreadPool* pool) {
+    int threads = SDL_min(raycast_thread_pool_size(pool), count);
+    if (count <= 0 || sync_grid(pathfinder) || reserve_searches(pathfinder, threads)) {
+        for (int i = 0; i < count; i++) {
+            queries[i].length = 0;
+        }
+        return;
+    }
+
+    PathBatchJob job = { .pathfinder = pathfinder, .queries = queries, .count = count };
+    SDL_SetAtomicInt(&job.next, 0);
+    raycast_thread_pool_run(pool, find_paths_task, &job, threads);
+}
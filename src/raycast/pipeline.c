@@ -0,0 +1,341 @@
+#include "raycast.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * @struct RaycastPipeline
+ * @brief Double-buffered frame pipeline that renders on a worker thread.
+ *
+ * Three framebuffers rotate between the worker (back), the hand-off slot (ready) and the
+ * main thread (front), so neither side waits on the other while the worker is ahead.
+ *
+ * @param raycaster The Raycaster frames are rendered from
+ * @param renderer The renderer frames are uploaded to and presented on
+ * @param pool Thread pool the worker spreads the columns of a frame over, or NULL
+ * @param texture Streaming texture the front buffer is uploaded into
+ * @param thread The render worker
+ * @param w The width of a frame
+ * @param h The height of a frame
+ * @param format Pixel format of the framebuffers, taken from the Raycaster at creation
+ * @param buffers The three framebuffers
+ * @param bufferTicks Input timestamp of the frame in each buffer
+ * @param back Buffer the worker renders into
+ * @param ready Buffer holding the newest finished frame, or -1
+ * @param front Buffer last uploaded by the main thread
+ * @param lock Protects everything below
+ * @param wake Signalled when a frame is submitted or the pipeline is shutting down
+ * @param done Signalled when the worker finishes a frame
+ * @param camera Camera of the pending frame
+ * @param background Background color of the pending frame
+ * @param inputTicks Input timestamp of the pending frame
+ * @param pending Whether a submitted frame has not been started yet
+ * @param busy Whether the worker is rendering
+ * @param quit Set when the pipeline is being destroyed
+ * @param drawnTicks Input timestamp of the frame drawn by the last raycast_pipeline_draw()
+ * @param drawn Whether a frame was drawn since the last raycast_pipeline_present()
+ * @param totalLatency Sum of all input-to-present latencies in nanoseconds
+ * @param stats Frame and latency counters
+ */
+struct RaycastPipeline {
+    Raycaster*           raycaster;
+    SDL_Renderer*        renderer;
+    RaycastThreadPool*   pool;
+    SDL_Texture*         texture;
+    SDL_Thread*          thread;
+    int                  w;
+    int                  h;
+    RaycastPixelFormat   format;
+    void*                buffers[3];
+    Uint64               bufferTicks[3];
+    int                  back;
+    int                  ready;
+    int                  front;
+    SDL_Mutex*           lock;
+    SDL_Condition*       wake;
+    SDL_Condition*       done;
+    RaycastCamera        camera;
+    RaycastColor         background;
+    Uint64               inputTicks;
+    bool                 pending;
+    bool                 busy;
+    bool                 quit;
+    Uint64               drawnTicks;
+    bool                 drawn;
+    Uint64               totalLatency;
+    RaycastPipelineStats stats;
+};
+
+/**
+ * @brief Render worker entry point.
+ *
+ * @param data The owning pipeline.
+ * @return Always 0.
+ */
+static int pipeline_main(void* data) {
+    RaycastPipeline* pipeline = (RaycastPipeline*) data;
+
+    SDL_LockMutex(pipeline->lock);
+    while (true) {
+        while (!pipeline->quit && !pipeline->pending) {
+            SDL_WaitCondition(pipeline->wake, pipeline->lock);
+        }
+        if (pipeline->quit) {
+            break;
+        }
+        if (pipeline->raycaster->pixelFormat != pipeline->format) {
+            // The framebuffers are sized for the creation format; drop the frame unrendered
+            pipeline->pending = false;
+            pipeline->stats.dropped++;
+            SDL_BroadcastCondition(pipeline->done);
+            continue;
+        }
+
+        RaycastCamera camera     = pipeline->camera;
+        RaycastColor  background = pipeline->background;
+        Uint64        inputTicks = pipeline->inputTicks;
+        int           back       = pipeline->back;
+        pipeline->pending        = false;
+        pipeline->busy           = true;
+        SDL_UnlockMutex(pipeline->lock);
+
+        raycast_render_batch(pipeline->raycaster,
+                             &camera,
+                             1,
+                             pipeline->pool,
+                             pipeline->buffers[back],
+                             NULL,
+                             pipeline->w,
+                             pipeline->h,
+                             &background);
+
+        SDL_LockMutex(pipeline->lock);
+        pipeline->bufferTicks[back] = inputTicks;
+        if (pipeline->ready >= 0) {
+            // The previous frame was never drawn; recycle its buffer
+            pipeline->stats.dropped++;
+            pipeline->back  = pipeline->ready;
+            pipeline->ready = back;
+        } else {
+            pipeline->ready = back;
+            pipeline->back  = 3 - pipeline->front - back;
+        }
+        pipeline->stats.rendered++;
+        pipeline->busy = false;
+        SDL_BroadcastCondition(pipeline->done);
+    }
+    SDL_UnlockMutex(pipeline->lock);
+    return 0;
+}
+
+/**
+ * @brief Create a frame pipeline.
+ *
+ * Frames are rendered with raycast_render_batch() on a dedicated worker thread, which spreads
+ * the columns over pool when one is given. The Raycaster must not be modified while a frame
+ * is in flight; call raycast_pipeline_wait() first. Frames are rendered and uploaded in the
+ * pixel format the Raycaster has at creation; frames submitted while it differs are dropped
+ * without being rendered.
+ *
+ * @param raycaster The Raycaster to render.
+ * @param renderer The renderer to upload and present frames on.
+ * @param pool Thread pool to render the columns of a frame with, or NULL.
+ * @param w The width of a frame.
+ * @param h The height of a frame.
+ * @return The newly allocated pipeline, or NULL on failure.
+ */
+RaycastPipeline* raycast_pipeline_create(
+    Raycaster* raycaster, SDL_Renderer* renderer, RaycastThreadPool* pool, int w, int h) {
+    if (!raycaster || !renderer || w <= 0 || h <= 0) {
+        return NULL;
+    }
+
+    RaycastPipeline* pipeline = (RaycastPipeline*) calloc(1, sizeof(RaycastPipeline));
+    if (!pipeline) {
+        return NULL;
+    }
+
+    pipeline->raycaster = raycaster;
+    pipeline->renderer  = renderer;
+    pipeline->pool      = pool;
+    pipeline->w         = w;
+    pipeline->h         = h;
+    pipeline->format    = raycaster->pixelFormat;
+    pipeline->front     = 0;
+    pipeline->back      = 1;
+    pipeline->ready     = -1;
+
+    for (int i = 0; i < 3; i++) {
+        pipeline->buffers[i] = malloc((size_t) w * h * raycast_pixel_size(pipeline->format));
+        if (!pipeline->buffers[i]) {
+            raycast_pipeline_destroy(pipeline);
+            return NULL;
+        }
+    }
+
+    pipeline->texture = SDL_CreateTexture(renderer,
+                                          raycast_pixel_format_sdl(pipeline->format),
+                                          SDL_TEXTUREACCESS_STREAMING,
+                                          w,
+                                          h);
+    pipeline->lock    = SDL_CreateMutex();
+    pipeline->wake    = SDL_CreateCondition();
+    pipeline->done    = SDL_CreateCondition();
+    if (!pipeline->texture || !pipeline->lock || !pipeline->wake || !pipeline->done) {
+        raycast_pipeline_destroy(pipeline);
+        return NULL;
+    }
+
+    pipeline->thread = SDL_CreateThread(pipeline_main, "raycast_pipeline", pipeline);
+    if (!pipeline->thread) {
+        raycast_pipeline_destroy(pipeline);
+        return NULL;
+    }
+
+    return pipeline;
+}
+
+/**
+ * @brief Stop the worker of a frame pipeline and free it.
+ *
+ * A frame that is being rendered is finished first; frames that were not started are
+ * discarded.
+ *
+ * @param pipeline The pipeline to destroy.
+ */
+void raycast_pipeline_destroy(RaycastPipeline* pipeline) {
+    if (!pipeline) {
+        return;
+    }
+
+    if (pipeline->thread) {
+        SDL_LockMutex(pipeline->lock);
+        pipeline->quit = true;
+        SDL_BroadcastCondition(pipeline->wake);
+        SDL_UnlockMutex(pipeline->lock);
+        SDL_WaitThread(pipeline->thread, NULL);
+    }
+
+    if (pipeline->texture) {
+        SDL_DestroyTexture(pipeline->texture);
+    }
+    for (int i = 0; i < 3; i++) {
+        free(pipeline->buffers[i]);
+    }
+    SDL_DestroyCondition(pipeline->done);
+    SDL_DestroyCondition(pipeline->wake);
+    SDL_DestroyMutex(pipeline->lock);
+    free(pipeline);
+}
+
+/**
+ * @brief Hand the next frame to the render worker.
+ *
+ * Never blocks. If the worker is still busy, the frame replaces any submitted frame it has
+ * not started yet, so it always picks up the newest camera.
+ *
+ * @param pipeline The pipeline.
+ * @param camera The camera to render the frame from.
+ * @param background The background color of the frame.
+ * @param inputTicks SDL_GetTicksNS() timestamp of the input the camera reflects.
+ */
+void raycast_pipeline_submit(RaycastPipeline*     pipeline,
+                             const RaycastCamera* camera,
+                             const RaycastColor*  background,
+                             Uint64               inputTicks) {
+    SDL_LockMutex(pipeline->lock);
+    if (pipeline->pending) {
+        pipeline->stats.skipped++;
+    }
+    pipeline->camera     = *camera;
+    pipeline->background = *background;
+    pipeline->inputTicks = inputTicks;
+    pipeline->pending    = true;
+    pipeline->stats.submitted++;
+    SDL_SignalCondition(pipeline->wake);
+    SDL_UnlockMutex(pipeline->lock);
+}
+
+/**
+ * @brief Wait until the render worker is idle.
+ *
+ * Call this before modifying the Raycaster of a running pipeline.
+ *
+ * @param pipeline The pipeline.
+ */
+void raycast_pipeline_wait(RaycastPipeline* pipeline) {
+    SDL_LockMutex(pipeline->lock);
+    while (pipeline->pending || pipeline->busy) {
+        SDL_WaitCondition(pipeline->done, pipeline->lock);
+    }
+    SDL_UnlockMutex(pipeline->lock);
+}
+
+/**
+ * @brief Upload the newest finished frame and draw it over the whole render target.
+ *
+ * Waits only if no finished frame is available but one is still in flight. The caller may
+ * draw overlays on top before calling raycast_pipeline_present().
+ *
+ * @param pipeline The pipeline.
+ * @return true if a frame was drawn, false if none was submitted since the last one.
+ */
+bool raycast_pipeline_draw(RaycastPipeline* pipeline) {
+    SDL_LockMutex(pipeline->lock);
+    while (pipeline->ready < 0 && (pipeline->pending || pipeline->busy)) {
+        SDL_WaitCondition(pipeline->done, pipeline->lock);
+    }
+    if (pipeline->ready < 0) {
+        SDL_UnlockMutex(pipeline->lock);
+        return false;
+    }
+    pipeline->front      = pipeline->ready;
+    pipeline->ready      = -1;
+    pipeline->drawnTicks = pipeline->bufferTicks[pipeline->front];
+    SDL_UnlockMutex(pipeline->lock);
+
+    SDL_UpdateTexture(pipeline->texture,
+                      NULL,
+                      pipeline->buffers[pipeline->front],
+                      pipeline->w * raycast_pixel_size(pipeline->format));
+    SDL_RenderTexture(pipeline->renderer, pipeline->texture, NULL, NULL);
+    pipeline->drawn = true;
+    return true;
+}
+
+/**
+ * @brief Present the render target and record the input-to-present latency of the frame.
+ *
+ * @param pipeline The pipeline.
+ */
+void raycast_pipeline_present(RaycastPipeline* pipeline) {
+    SDL_RenderPresent(pipeline->renderer);
+    if (!pipeline->drawn) {
+        return;
+    }
+
+    Uint64 latency  = SDL_GetTicksNS() - pipeline->drawnTicks;
+    pipeline->drawn = false;
+
+    SDL_LockMutex(pipeline->lock);
+    pipeline->totalLatency += latency;
+    pipeline->stats.presented++;
+    pipeline->stats.lastLatency    = latency;
+    pipeline->stats.averageLatency = pipeline->totalLatency / pipeline->stats.presented;
+    if (latency > pipeline->stats.maxLatency) {
+        pipeline->stats.maxLatency = latency;
+    }
+    SDL_UnlockMutex(pipeline->lock);
+}
+
+/**
+ * @brief Get the frame and latency counters of a pipeline.
+ *
+ * @param pipeline The pipeline.
+ * @param stats Filled with a snapshot of the counters.
+ */
+void raycast_pipeline_stats(RaycastPipeline* pipeline, RaycastPipelineStats* stats) {
+    SDL_LockMutex(pipeline->lock);
+    *stats = pipeline->stats;
+    SDL_UnlockMutex(pipeline->lock);
+}
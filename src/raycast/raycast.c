@@ -1,180 +1,1810 @@
 #include "raycast.h"
 
 #include <SDL3/SDL_oldnames.h>
+#include <limits.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 
+/**
+ * @brief Blend a color toward a target color, keeping the alpha of the original.
+ *
+ * @param color The color to blend.
+ * @param target The color to blend toward.
+ * @param amount Blend amount from 0 (color) to 256 (target).
+ * @return The blended color.
+ */
+static inline RaycastColor blend_color(RaycastColor color, RaycastColor target, int amount) {
+    int r = (color >> 16) & 0xFF;
+    int g = (color >> 8) & 0xFF;
+    int b = color & 0xFF;
+    r += ((((target >> 16) & 0xFF) - r) * amount) >> 8;
+    g += ((((target >> 8) & 0xFF) - g) * amount) >> 8;
+    b += (((target & 0xFF) - b) * amount) >> 8;
+    return (color & (RaycastColor) 0xFF000000) | (r << 16) | (g << 8) | b;
+}
+
+/**
+ * @brief Darken a color for walls hit on their horizontal side.
+ *
+ * @param color The color to darken.
+ * @return The color with its RGB channels halved.
+ */
+static inline RaycastColor shade_side(RaycastColor color) {
+    int r = ((color >> 16) & 0xFF) / 2;
+    int g = ((color >> 8) & 0xFF) / 2;
+    int b = (color & 0xFF) / 2;
+    int a = (color >> 24) & 0xFF;
+    return (RaycastColor) (((uint32_t) a << 24) | (r << 16) | (g << 8) | b);
+}
+
+/**
+ * @brief Get how strongly fog covers a wall at the given distance.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param distance Distance to the wall.
+ * @return Fog amount from 0 (no fog, or fog disabled) to 256 (fully fogged).
+ */
+static inline int fog_amount(const Raycaster* raycaster, float distance) {
+    if (raycaster->maxDistance <= 0.0f || distance <= 0.0f) {
+        return 0;
+    }
+    if (distance >= raycaster->maxDistance) {
+        return 256;
+    }
+    return (int) (distance * 256.0f / raycaster->maxDistance);
+}
+
+/**
+ * @brief Get the precomputed palette variant for a wall column of an indexed texture.
+ *
+ * @param texture The texture of the column.
+ * @param side Which side of the wall was hit.
+ * @param fog Fog amount of the column (see fog_amount).
+ * @param fogColor The current fog color.
+ * @return The 256-entry palette with side shading and fog applied, or NULL if the texture is
+ *         not indexed or has no shades built for this fog color.
+ */
+static inline const RaycastColor*
+palette_shades(const RaycastTexture* texture, int side, int fog, RaycastColor fogColor) {
+    const RaycastPalette* palette = texture->palette;
+    if (!texture->indices || !palette || !palette->shades || palette->shadeFogColor != fogColor) {
+        return NULL;
+    }
+    int level = (fog * (RAYCAST_FOG_LEVELS - 1) + 128) >> 8;
+    return palette->shades + (side * RAYCAST_FOG_LEVELS + level) * RAYCAST_PALETTE_SIZE;
+}
+
+/**
+ * @brief Scale the RGB channels of a color by a light level.
+ *
+ * @param color The color to light.
+ * @param light Row of RaycastLighting.table for the light level.
+ * @return The lit color, with the alpha of the original.
+ */
+static inline RaycastColor light_color(RaycastColor color, const uint8_t* light) {
+    return (color & (RaycastColor) 0xFF000000) | (light[(color >> 16) & 0xFF] << 16)
+           | (light[(color >> 8) & 0xFF] << 8) | light[color & 0xFF];
+}
+
+/**
+ * @brief Sample a wall texel and apply side shading, lighting and fog.
+ *
+ * @param texture The texture to sample.
+ * @param offset Texel offset (y * width + x).
+ * @param shades Palette from palette_shades(), or NULL to shade the texel directly.
+ * @param side Which side of the wall was hit.
+ * @param light Light table row of the wall face (see light_color), or NULL if unlit.
+ * @param fog Fog amount of the column (see fog_amount).
+ * @param fogColor The current fog color.
+ * @return The shaded texel.
+ */
+static inline RaycastColor wall_texel(const RaycastTexture* texture,
+                                      int                   offset,
+                                      const RaycastColor*   shades,
+                                      int                   side,
+                                      const uint8_t*        light,
+                                      int                   fog,
+                                      RaycastColor          fogColor) {
+    if (shades) {
+        return shades[texture->indices[offset]];
+    }
+
+    RaycastColor color = texture->indices ? texture->palette->colors[texture->indices[offset]]
+                                          : texture->pixels[offset];
+    if (side == 1) {
+        color = shade_side(color);
+    }
+    if (light) {
+        color = light_color(color, light);
+    }
+    if (fog) {
+        color = blend_color(color, fogColor, fog);
+    }
+    return color;
+}
+
+/**
+ * @brief Get the value a legacy map would store for a cell type.
+ *
+ * @param type The cell type.
+ * @return The texture ID of the type, or its color if it is not textured.
+ */
+static inline int cell_type_value(const RaycastCellType* type) {
+    return (type->textureId >= 0) ? type->textureId : type->color;
+}
+
+/**
+ * @brief Get the stored value of a cell (a cell type ID for compact maps).
+ *
+ * Reads through the row pointers of snapshot views and directly from live maps.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param index Index of the cell (y * width + x).
+ * @return The stored value of the cell.
+ */
+static inline int cell_raw(const Raycaster* raycaster, int index) {
+    const void* cells
+        = (raycaster->cellBits == 32) ? (const void*) raycaster->map : raycaster->cells;
+    if (raycaster->rows) {
+        cells = raycaster->rows[index / raycaster->width];
+        index %= raycaster->width;
+    }
+    switch (raycaster->cellBits) {
+    case 8:
+        return ((const uint8_t*) cells)[index];
+    case 16:
+        return ((const uint16_t*) cells)[index];
+    default:
+        return ((const RaycastColor*) cells)[index];
+    }
+}
+
+/**
+ * @brief Get the map value of a cell (a color, or a texture ID for textured maps).
+ *
+ * @param raycaster The Raycaster instance.
+ * @param index Index of the cell (y * width + x).
+ * @return The value of the cell, or RAYCAST_EMPTY if it is empty.
+ */
+static inline int cell_value(const Raycaster* raycaster, int index) {
+    int raw = cell_raw(raycaster, index);
+    return (raycaster->cellBits == 32) ? raw : cell_type_value(&raycaster->cellTypes[raw]);
+}
+
+/**
+ * @brief Get the display color of a cell, ignoring textures.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param index Index of the cell (y * width + x).
+ * @return The color of the cell, or RAYCAST_EMPTY if it is empty.
+ */
+static inline RaycastColor cell_color(const Raycaster* raycaster, int index) {
+    int raw = cell_raw(raycaster, index);
+    return (raycaster->cellBits == 32) ? raw : raycaster->cellTypes[raw].color;
+}
+
+/**
+ * @brief Find the slot of a cell in the sorted thin wall table.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param index Index of the cell (y * width + x).
+ * @return The position of the cell's thin wall, or of the first wall after it if it has none.
+ */
+static int thin_wall_slot(const Raycaster* raycaster, int index) {
+    int low  = 0;
+    int high = raycaster->thinWallCount;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (raycaster->thinWalls[middle].cell < index) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Get the thin wall of a cell.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param index Index of the cell (y * width + x).
+ * @return The thin wall of the cell, or NULL if it has none.
+ */
+static inline RaycastThinWall* find_thin_wall(const Raycaster* raycaster, int index) {
+    if (raycaster->thinWallCount == 0) {
+        return NULL;
+    }
+    int slot = thin_wall_slot(raycaster, index);
+    return (slot < raycaster->thinWallCount && raycaster->thinWalls[slot].cell == index)
+               ? &raycaster->thinWalls[slot]
+               : NULL;
+}
+
+/**
+ * @brief Intersect a ray with the panel of a thin wall.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param wall The thin wall.
+ * @param x The x coordinate of the ray origin.
+ * @param y The y coordinate of the ray origin.
+ * @param dirX The x component of the unit ray direction.
+ * @param dirY The y component of the unit ray direction.
+ * @param hit Filled with the hit information if the ray hits the closed part of the panel.
+ * @return true if the ray hits the panel, false if it passes the cell.
+ */
+static bool thin_wall_hit(const Raycaster*       raycaster,
+                          const RaycastThinWall* wall,
+                          float                  x,
+                          float                  y,
+                          float                  dirX,
+                          float                  dirY,
+                          RaycastHit*            hit) {
+    int   mapX = wall->cell % raycaster->width;
+    int   mapY = wall->cell / raycaster->width;
+    float distance;
+    float along;
+    if (wall->orientation == RAYCAST_THIN_VERTICAL) {
+        if (dirX == 0.0f) {
+            return false;
+        }
+        distance = (mapX + wall->offset - x) / dirX;
+        along    = y + distance * dirY - mapY;
+    } else {
+        if (dirY == 0.0f) {
+            return false;
+        }
+        distance = (mapY + wall->offset - y) / dirY;
+        along    = x + distance * dirX - mapX;
+    }
+
+    // The door slides toward the low edge of the cell, uncovering along < open
+    float maxDistance = (raycaster->maxDistance > 0.0f) ? raycaster->maxDistance : INFINITY;
+    if (distance < 0.0f || distance > maxDistance || along < wall->open || along >= 1.0f) {
+        return false;
+    }
+
+    hit->distance  = distance;
+    hit->wallX     = along - wall->open;
+    hit->side      = (wall->orientation == RAYCAST_THIN_VERTICAL) ? 0 : 1;
+    hit->textureId = cell_value(raycaster, wall->cell);
+    hit->cell      = wall->cell;
+    return true;
+}
+
+/**
+ * @brief State of a ray marched in unit steps.
+ */
+typedef struct {
+    float currentX;
+    float currentY;
+    float stepX;
+    float stepY;
+    int   prevMapX;
+    float traveled;
+} MarchState;
+
+/**
+ * @brief State of a ray traversed with DDA.
+ */
+typedef struct {
+    int   mapX;
+    int   mapY;
+    int   stepX;
+    int   stepY;
+    int   side;
+    float sideDistX;
+    float sideDistY;
+    float deltaDistX;
+    float deltaDistY;
+} DdaState;
+
+/**
+ * @brief Read a cell of a live map (cells is the flat cell array).
+ */
+#define FLAT_CELL(cells, x, y) ((cells)[width * (y) + (x)])
+
+/**
+ * @brief Read a cell of a snapshot view (cells is the row pointer table).
+ */
+#define ROW_CELL(cells, x, y) ((cells)[y][x])
+
+/**
+ * @brief Define a unit-step ray march specialized for one map cell type and layout.
+ *
+ * CELLS is the cell storage of type TYPE and CELL(cells, x, y) reads one cell from it.
+ * The generated function advances the state until it is inside a non-empty cell and
+ * returns the index of that cell, or returns -1 if the ray leaves the map or travels
+ * further than maxTravel.
+ */
+#define DEFINE_MARCH_WALK(NAME, TYPE, CELLS, CELL, EMPTY)                                          \
+    static int NAME(const Raycaster* raycaster, MarchState* state, float maxTravel) {              \
+        TYPE  cells    = (TYPE) (CELLS);                                                           \
+        int   width    = raycaster->width;                                                         \
+        int   height   = raycaster->height;                                                        \
+        float currentX = state->currentX;                                                          \
+        float currentY = state->currentY;                                                          \
+        float traveled = state->traveled;                                                          \
+        int   prevMapX = state->prevMapX;                                                          \
+        int   index    = -1;                                                                       \
+        while (currentX >= 0 && currentX < width && currentY >= 0 && currentY < height             \
+               && traveled <= maxTravel) {                                                         \
+            int mapX = (int) currentX;                                                             \
+            int mapY = (int) currentY;                                                             \
+            if (CELL(cells, mapX, mapY) != (EMPTY)) {                                              \
+                index = mapY * width + mapX;                                                       \
+                break;                                                                             \
+            }                                                                                      \
+            prevMapX = mapX;                                                                       \
+            currentX += state->stepX;                                                              \
+            currentY += state->stepY;                                                              \
+            traveled += 1.0f;                                                                      \
+        }                                                                                          \
+        state->currentX = currentX;                                                                \
+        state->currentY = currentY;                                                                \
+        state->traveled = traveled;                                                                \
+        state->prevMapX = prevMapX;                                                                \
+        return index;                                                                              \
+    }
+
+/**
+ * @brief Define a DDA traversal specialized for one map cell type and layout.
+ *
+ * The parameters are the same as for DEFINE_MARCH_WALK. The generated function steps the
+ * state cell by cell until it enters a non-empty cell and returns true, or returns false if
+ * the ray leaves the map, runs out of steps or the next cell boundary is further than
+ * maxDistance. The state can be walked again to continue past the returned cell.
+ */
+#define DEFINE_DDA_WALK(NAME, TYPE, CELLS, CELL, EMPTY)                                            \
+    static bool NAME(const Raycaster* raycaster, DdaState* state, float maxDistance) {             \
+        TYPE  cells     = (TYPE) (CELLS);                                                          \
+        int   width     = raycaster->width;                                                        \
+        int   height    = raycaster->height;                                                       \
+        int   maxSteps  = width + height;                                                          \
+        int   mapX      = state->mapX;                                                             \
+        int   mapY      = state->mapY;                                                             \
+        int   side      = state->side;                                                             \
+        float sideDistX = state->sideDistX;                                                        \
+        float sideDistY = state->sideDistY;                                                        \
+        bool  hitWall   = false;                                                                   \
+        for (int i = 0; i < maxSteps; i++) {                                                       \
+            /* Stop once the next cell boundary is beyond the view distance */                     \
+            if (fminf(sideDistX, sideDistY) > maxDistance) {                                       \
+                break;                                                                             \
+            }                                                                                      \
+            if (sideDistX < sideDistY) {                                                           \
+                sideDistX += state->deltaDistX;                                                    \
+                mapX += state->stepX;                                                              \
+                side = 0;                                                                          \
+            } else {                                                                               \
+                sideDistY += state->deltaDistY;                                                    \
+                mapY += state->stepY;                                                              \
+                side = 1;                                                                          \
+            }                                                                                      \
+            if (mapX < 0 || mapX >= width || mapY < 0 || mapY >= height) {                         \
+                break;                                                                             \
+            }                                                                                      \
+            if (CELL(cells, mapX, mapY) != (EMPTY)) {                                              \
+                hitWall = true;                                                                    \
+                break;                                                                             \
+            }                                                                                      \
+        }                                                                                          \
+        state->mapX      = mapX;                                                                   \
+        state->mapY      = mapY;                                                                   \
+        state->side      = side;                                                                   \
+        state->sideDistX = sideDistX;                                                              \
+        state->sideDistY = sideDistY;                                                              \
+        return hitWall;                                                                            \
+    }
+
+DEFINE_MARCH_WALK(march_walk_map, const RaycastColor*, raycaster->map, FLAT_CELL, RAYCAST_EMPTY)
+DEFINE_MARCH_WALK(
+    march_walk_cells8, const uint8_t*, raycaster->cells, FLAT_CELL, RAYCAST_CELL_EMPTY)
+DEFINE_MARCH_WALK(
+    march_walk_cells16, const uint16_t*, raycaster->cells, FLAT_CELL, RAYCAST_CELL_EMPTY)
+DEFINE_MARCH_WALK(
+    march_walk_map_rows, const RaycastColor* const*, raycaster->rows, ROW_CELL, RAYCAST_EMPTY)
+DEFINE_MARCH_WALK(
+    march_walk_cells8_rows, const uint8_t* const*, raycaster->rows, ROW_CELL, RAYCAST_CELL_EMPTY)
+DEFINE_MARCH_WALK(
+    march_walk_cells16_rows, const uint16_t* const*, raycaster->rows, ROW_CELL, RAYCAST_CELL_EMPTY)
+DEFINE_DDA_WALK(dda_walk_map, const RaycastColor*, raycaster->map, FLAT_CELL, RAYCAST_EMPTY)
+DEFINE_DDA_WALK(dda_walk_cells8, const uint8_t*, raycaster->cells, FLAT_CELL, RAYCAST_CELL_EMPTY)
+DEFINE_DDA_WALK(dda_walk_cells16, const uint16_t*, raycaster->cells, FLAT_CELL, RAYCAST_CELL_EMPTY)
+DEFINE_DDA_WALK(
+    dda_walk_map_rows, const RaycastColor* const*, raycaster->rows, ROW_CELL, RAYCAST_EMPTY)
+DEFINE_DDA_WALK(
+    dda_walk_cells8_rows, const uint8_t* const*, raycaster->rows, ROW_CELL, RAYCAST_CELL_EMPTY)
+DEFINE_DDA_WALK(
+    dda_walk_cells16_rows, const uint16_t* const*, raycaster->rows, ROW_CELL, RAYCAST_CELL_EMPTY)
+
+/**
+ * @brief March a ray using the walker specialized for the map's cell width and layout.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param state The ray state.
+ * @param maxTravel Maximum distance to travel.
+ * @return Index of the hit cell, or -1 if nothing was hit.
+ */
+static inline int march_walk(const Raycaster* raycaster, MarchState* state, float maxTravel) {
+    if (raycaster->rows) {
+        switch (raycaster->cellBits) {
+        case 8:
+            return march_walk_cells8_rows(raycaster, state, maxTravel);
+        case 16:
+            return march_walk_cells16_rows(raycaster, state, maxTravel);
+        default:
+            return march_walk_map_rows(raycaster, state, maxTravel);
+        }
+    }
+    switch (raycaster->cellBits) {
+    case 8:
+        return march_walk_cells8(raycaster, state, maxTravel);
+    case 16:
+        return march_walk_cells16(raycaster, state, maxTravel);
+    default:
+        return march_walk_map(raycaster, state, maxTravel);
+    }
+}
+
+/**
+ * @brief Traverse a ray with the DDA walker specialized for the map's cell width and layout.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param state The ray state.
+ * @param maxDistance Maximum distance to traverse.
+ * @return true if a non-empty cell was entered, false otherwise.
+ */
+static inline bool dda_walk(const Raycaster* raycaster, DdaState* state, float maxDistance) {
+    if (raycaster->rows) {
+        switch (raycaster->cellBits) {
+        case 8:
+            return dda_walk_cells8_rows(raycaster, state, maxDistance);
+        case 16:
+            return dda_walk_cells16_rows(raycaster, state, maxDistance);
+        default:
+            return dda_walk_map_rows(raycaster, state, maxDistance);
+        }
+    }
+    switch (raycaster->cellBits) {
+    case 8:
+        return dda_walk_cells8(raycaster, state, maxDistance);
+    case 16:
+        return dda_walk_cells16(raycaster, state, maxDistance);
+    default:
+        return dda_walk_map(raycaster, state, maxDistance);
+    }
+}
+
+/**
+ * @brief March a ray in unit steps from a point and fill in information about the first hit.
+ *
+ * The side and wall position are estimated from the cell boundary the last step crossed.
+ *
+ * @param raycaster The Raycaster instance containing the map.
+ * @param x The x coordinate of the starting point.
+ * @param y The y coordinate of the starting point.
+ * @param angle The angle of the ray in degrees.
+ * @param hit Pointer to store the hit information.
+ * @return true if a non-empty cell was hit, false otherwise.
+ */
+static bool cast_march(Raycaster* raycaster, float x, float y, float angle, RaycastHit* hit) {
+    MarchState state     = { .currentX = x,
+                             .currentY = y,
+                             .stepX    = cosf(angle * (M_PI / 180.0f)),
+                             .stepY    = sinf(angle * (M_PI / 180.0f)),
+                             .prevMapX = (int) x,
+                             .traveled = 0.0f };
+    float      maxTravel = (raycaster->maxDistance > 0.0f) ? raycaster->maxDistance : INFINITY;
+    int        index     = march_walk(raycaster, &state, maxTravel);
+
+    if (index < 0) {
+        hit->distance  = 0.0f;
+        hit->wallX     = 0.0f;
+        hit->side      = 0;
+        hit->textureId = -1;
+        hit->cell      = -1;
+        return false;
+    }
+
+    int   mapX     = index % raycaster->width;
+    int   mapY     = index / raycaster->width;
+    float dx       = state.currentX - x;
+    float dy       = state.currentY - y;
+    hit->distance  = sqrtf(dx * dx + dy * dy);
+    hit->side      = (mapX != state.prevMapX) ? 0 : 1;
+    hit->wallX     = (hit->side == 0) ? state.currentY - mapY : state.currentX - mapX;
+    hit->textureId = cell_value(raycaster, index);
+    hit->cell      = index;
+    return true;
+}
+
+/**
+ * @brief Store the hit information of one column in a G-buffer.
+ *
+ * @param gbuffer The G-buffer to fill, or NULL.
+ * @param column The column index.
+ * @param hit The hit information of the column.
+ */
+static inline void gbuffer_store(RaycastGBuffer* gbuffer, int column, const RaycastHit* hit) {
+    if (!gbuffer) {
+        return;
+    }
+    if (gbuffer->distance)
+        gbuffer->distance[column] = hit->distance;
+    if (gbuffer->cell)
+        gbuffer->cell[column] = hit->cell;
+    if (gbuffer->textureId)
+        gbuffer->textureId[column] = hit->textureId;
+    if (gbuffer->side)
+        gbuffer->side[column] = (uint8_t) hit->side;
+    if (gbuffer->wallX)
+        gbuffer->wallX[column] = hit->wallX;
+}
+
+/**
+ * @brief Iterator over the runs of identical texels in a textured wall column.
+ */
+typedef struct {
+    const RaycastTexture* texture;
+    const RaycastColor*   shades;
+    const uint8_t*        light;
+    RaycastColor          fogColor;
+    int                   texX;
+    int                   side;
+    int                   fog;
+    int                   shift;
+    int                   wallTop;
+    int                   wallHeight;
+    int                   y;
+    int                   bottom;
+} WallSpans;
+
+/**
+ * @brief Get the texture row sampled by a screen row of a wall column.
+ *
+ * @param spans The wall column.
+ * @param y The screen row.
+ * @return The texture row.
+ */
+static inline int wall_span_row(const WallSpans* spans, int y) {
+    float texY      = (float) (y - spans->wallTop) / (float) spans->wallHeight;
+    int   texYCoord = (int) (texY * spans->texture->height);
+    if (texYCoord < 0)
+        texYCoord = 0;
+    if (texYCoord >= spans->texture->height)
+        texYCoord = spans->texture->height - 1;
+    return texYCoord;
+}
+
+/**
+ * @brief Find the end of the run of screen rows that sample one texture row.
+ *
+ * The end is estimated from the wall scale and then corrected against wall_span_row(), so
+ * the runs match a per-pixel walk exactly.
+ *
+ * @param spans The wall column.
+ * @param y First screen row of the run.
+ * @param row Texture row sampled at y.
+ * @param pot Whether the texture height is a power of two (spans->shift is valid).
+ * @return One past the last screen row of the run.
+ */
+static inline int wall_span_end(const WallSpans* spans, int y, int row, bool pot) {
+    int height = spans->texture->height;
+    int end    = spans->bottom;
+    if (row < height - 1) {
+        int64_t scaled = (int64_t) (row + 1) * spans->wallHeight + height - 1;
+        end            = spans->wallTop + (int) (pot ? scaled >> spans->shift : scaled / height);
+    }
+    if (end <= y)
+        end = y + 1;
+    if (end > spans->bottom)
+        end = spans->bottom;
+
+    while (end > y + 1 && wall_span_row(spans, end - 1) != row) {
+        end--;
+    }
+    while (end < spans->bottom && wall_span_row(spans, end) == row) {
+        end++;
+    }
+    return end;
+}
+
+/**
+ * @brief Get the next run of identically colored pixels of a wall column.
+ *
+ * Neighbouring texture rows of the same shaded color are merged into one run.
+ *
+ * @param spans The wall column.
+ * @param top Set to the first screen row of the run.
+ * @param bottom Set to one past the last screen row of the run.
+ * @param color Set to the color of the run.
+ * @return true if a run was returned, false if the column is done.
+ */
+static inline bool wall_span_next(WallSpans* spans, int* top, int* bottom, RaycastColor* color) {
+    if (spans->y >= spans->bottom) {
+        return false;
+    }
+
+    const RaycastTexture* texture = spans->texture;
+    int                   y       = spans->y;
+    int                   row     = wall_span_row(spans, y);
+    *top                          = y;
+
+    // The run takes the color of its first texel and grows while the next rows match it
+    *color = wall_texel(texture,
+                        row * texture->width + spans->texX,
+                        spans->shades,
+                        spans->side,
+                        spans->light,
+                        spans->fog,
+                        spans->fogColor);
+
+    while ((y = wall_span_end(spans, y, row, false)) < spans->bottom) {
+        row = wall_span_row(spans, y);
+        if (wall_texel(texture,
+                       row * texture->width + spans->texX,
+                       spans->shades,
+                       spans->side,
+                       spans->light,
+                       spans->fog,
+                       spans->fogColor)
+            != *color) {
+            break;
+        }
+    }
+
+    spans->y = y;
+    *bottom  = y;
+    return true;
+}
+
+/**
+ * @brief Start iterating the runs of a textured wall column.
+ *
+ * @param spans The iterator to initialize.
+ * @param raycaster The Raycaster instance.
+ * @param hit The hit of the column; its texture ID must be valid.
+ * @param wallTop Screen row of the top of the wall (may be off screen).
+ * @param wallHeight Height of the wall in screen rows.
+ * @param drawTop First visible screen row of the wall.
+ * @param drawBottom One past the last visible screen row of the wall.
+ * @param light Light table row of the wall face (see hit_light), or NULL if unlit.
+ */
+static inline void wall_spans_init(WallSpans*        spans,
+                                   const Raycaster*  raycaster,
+                                   const RaycastHit* hit,
+                                   int               wallTop,
+                                   int               wallHeight,
+                                   int               drawTop,
+                                   int               drawBottom,
+                                   const uint8_t*    light) {
+    RaycastTexture* texture = raycaster->textures[hit->textureId];
+    int             texX    = (int) (hit->wallX * texture->width);
+    if (texX < 0)
+        texX = 0;
+    if (texX >= texture->width)
+        texX = texture->width - 1;
+
+    spans->texture    = texture;
+    spans->fogColor   = raycaster->fogColor;
+    spans->texX       = texX;
+    spans->side       = hit->side;
+    spans->fog        = fog_amount(raycaster, hit->distance);
+    spans->light      = light;
+    spans->shades     = NULL;
+    spans->shift      = SDL_HasExactlyOneBitSet32((Uint32) texture->height)
+                            ? SDL_MostSignificantBitIndex32((Uint32) texture->height)
+                            : -1;
+    spans->wallTop    = wallTop;
+    spans->wallHeight = wallHeight;
+    spans->y          = drawTop;
+    spans->bottom     = drawBottom;
+
+    // Precomputed shades already include fog, which has to go on top of the light
+    if (!light) {
+        spans->shades = palette_shades(texture, hit->side, spans->fog, raycaster->fogColor);
+    }
+}
+
+/**
+ * @brief Convert an ARGB color to an output pixel format.
+ *
+ * @param color The ARGB color.
+ * @param format The output pixel format.
+ * @return The pixel, in the low 16 bits for 16-bit formats.
+ */
+static inline Uint32 convert_color(RaycastColor color, RaycastPixelFormat format) {
+    Uint32 argb = (Uint32) color;
+    switch (format) {
+    case RAYCAST_PIXEL_XRGB8888:
+        return argb | 0xFF000000;
+    case RAYCAST_PIXEL_ABGR8888:
+        return (argb & 0xFF00FF00) | ((argb >> 16) & 0xFF) | ((argb & 0xFF) << 16);
+    case RAYCAST_PIXEL_RGB565:
+        return ((argb >> 8) & 0xF800) | ((argb >> 5) & 0x07E0) | ((argb >> 3) & 0x001F);
+    default:
+        return argb;
+    }
+}
+
+/**
+ * @brief Fill rows [y0, y1) of one framebuffer column with a color.
+ *
+ * @param pixels Row-major framebuffer.
+ * @param w The width of the framebuffer.
+ * @param x The column to fill.
+ * @param y0 First row to fill.
+ * @param y1 One past the last row to fill.
+ * @param color The fill color.
+ */
+static inline void
+fill_column(RaycastColor* pixels, int w, int x, int y0, int y1, RaycastColor color) {
+    RaycastColor* pixel = pixels + (size_t) y0 * w + x;
+    for (int y = y0; y < y1; y++, pixel += w) {
+        *pixel = color;
+    }
+}
+
+/**
+ * @brief Fill rows [y0, y1) of one 16-bit framebuffer column with a pixel.
+ *
+ * @param pixels Row-major framebuffer.
+ * @param w The width of the framebuffer.
+ * @param x The column to fill.
+ * @param y0 First row to fill.
+ * @param y1 One past the last row to fill.
+ * @param pixel The fill pixel.
+ */
+static inline void fill_column16(uint16_t* pixels, int w, int x, int y0, int y1, uint16_t pixel) {
+    uint16_t* out = pixels + (size_t) y0 * w + x;
+    for (int y = y0; y < y1; y++, out += w) {
+        *out = pixel;
+    }
+}
+
+/**
+ * @brief Fill rows [y0, y1) of one framebuffer column of any output format with a color.
+ *
+ * The color is converted once; the fill itself writes the converted pixel as is.
+ *
+ * @param pixels Row-major framebuffer in the given format.
+ * @param format The pixel format of the framebuffer.
+ * @param w The width of the framebuffer.
+ * @param x The column to fill.
+ * @param y0 First row to fill.
+ * @param y1 One past the last row to fill.
+ * @param color The ARGB fill color.
+ */
+static inline void fill_pixels(
+    void* pixels, RaycastPixelFormat format, int w, int x, int y0, int y1, RaycastColor color) {
+    Uint32 pixel = convert_color(color, format);
+    if (format == RAYCAST_PIXEL_RGB565) {
+        fill_column16((uint16_t*) pixels, w, x, y0, y1, (uint16_t) pixel);
+    } else {
+        fill_column((RaycastColor*) pixels, w, x, y0, y1, (RaycastColor) pixel);
+    }
+}
+
+#define TEXELS_ARGB    0 // ARGB texels, shaded per run
+#define TEXELS_INDEXED 1 // Palette indices, shaded per run
+#define TEXELS_SHADED  2 // Palette indices into a precomputed shaded palette
+
+/**
+ * @brief Sample a wall texel for one column kernel variant.
+ *
+ * Every argument but spans and offset is a compile-time constant in the kernels, so the
+ * source and shading branches fold away.
+ *
+ * @param spans The wall column.
+ * @param offset Texel offset (y * width + x).
+ * @param source Texel layout, one of the TEXELS_* constants.
+ * @param side Whether to apply side shading.
+ * @param lit Whether to apply the light level of the wall face.
+ * @param fog Whether to apply fog.
+ * @return The shaded texel, identical to wall_texel().
+ */
+static inline RaycastColor
+kernel_texel(const WallSpans* spans, int offset, int source, bool side, bool lit, bool fog) {
+    const RaycastTexture* texture = spans->texture;
+    if (source == TEXELS_SHADED) {
+        return spans->shades[texture->indices[offset]];
+    }
+
+    RaycastColor color = (source == TEXELS_INDEXED)
+                             ? texture->palette->colors[texture->indices[offset]]
+                             : texture->pixels[offset];
+    if (side) {
+        color = shade_side(color);
+    }
+    if (lit) {
+        color = light_color(color, spans->light);
+    }
+    if (fog) {
+        color = blend_color(color, spans->fogColor, spans->fog);
+    }
+    return color;
+}
+
+/**
+ * @brief Define a column kernel that draws a textured wall column for one configuration.
+ *
+ * Each kernel walks the same runs as wall_span_next() and fills them with fill_pixels(), but
+ * with the texel layout, side shading, lighting, fog, power-of-two run estimate and output
+ * format fixed at compile time, so neither the runs nor the pixels test the configuration.
+ * Each run is converted to the output format once, before it is filled.
+ */
+#define DEFINE_COLUMN_KERNEL(NAME, FORMAT, SOURCE, SIDE, LIT, FOG, POT)                            \
+    static void NAME(void* pixels, int w, int x, const WallSpans* spans) {                         \
+        int texX  = spans->texX;                                                                   \
+        int width = spans->texture->width;                                                         \
+        int y     = spans->y;                                                                      \
+        while (y < spans->bottom) {                                                                \
+            int          top    = y;                                                               \
+            int          row    = wall_span_row(spans, y);                                         \
+            int          offset = row * width + texX;                                              \
+            RaycastColor color  = kernel_texel(spans, offset, SOURCE, SIDE, LIT, FOG);             \
+            while ((y = wall_span_end(spans, y, row, POT)) < spans->bottom) {                      \
+                row    = wall_span_row(spans, y);                                                  \
+                offset = row * width + texX;                                                       \
+                if (kernel_texel(spans, offset, SOURCE, SIDE, LIT, FOG) != color) {                \
+                    break;                                                                         \
+                }                                                                                  \
+            }                                                                                      \
+            fill_pixels(pixels, FORMAT, w, x, top, y, color);                                      \
+        }                                                                                          \
+    }
+
+/**
+ * @brief Define the kernels of one output format, texture height class and lighting, and
+ * their table.
+ *
+ * The table is indexed by (shaded palette ? 8 : indexed * 4 + side * 2 + fog).
+ */
+#define DEFINE_COLUMN_KERNELS(SUFFIX, FORMAT, POT, LIT)                                            \
+    DEFINE_COLUMN_KERNEL(column_argb##SUFFIX, FORMAT, TEXELS_ARGB, false, LIT, false, POT)         \
+    DEFINE_COLUMN_KERNEL(column_argb_fog##SUFFIX, FORMAT, TEXELS_ARGB, false, LIT, true, POT)      \
+    DEFINE_COLUMN_KERNEL(column_argb_side##SUFFIX, FORMAT, TEXELS_ARGB, true, LIT, false, POT)     \
+    DEFINE_COLUMN_KERNEL(column_argb_side_fog##SUFFIX, FORMAT, TEXELS_ARGB, true, LIT, true, POT)  \
+    DEFINE_COLUMN_KERNEL(column_indexed##SUFFIX, FORMAT, TEXELS_INDEXED, false, LIT, false, POT)   \
+    DEFINE_COLUMN_KERNEL(column_indexed_fog##SUFFIX,                                               \
+                         FORMAT,                                                                   \
+                         TEXELS_INDEXED,                                                           \
+                         false,                                                                    \
+                         LIT,                                                                      \
+                         true,                                                                     \
+                         POT)                                                                      \
+    DEFINE_COLUMN_KERNEL(column_indexed_side##SUFFIX,                                              \
+                         FORMAT,                                                                   \
+                         TEXELS_INDEXED,                                                           \
+                         true,                                                                     \
+                         LIT,                                                                      \
+                         false,                                                                    \
+                         POT)                                                                      \
+    DEFINE_COLUMN_KERNEL(column_indexed_side_fog##SUFFIX,                                          \
+                         FORMAT,                                                                   \
+                         TEXELS_INDEXED,                                                           \
+                         true,                                                                     \
+                         LIT,                                                                      \
+                         true,                                                                     \
+                         POT)                                                                      \
+    DEFINE_COLUMN_KERNEL(column_shaded##SUFFIX, FORMAT, TEXELS_SHADED, false, LIT, false, POT)     \
+    static const ColumnKernel column_kernels##SUFFIX[9] = {                                        \
+        column_argb##SUFFIX,          column_argb_fog##SUFFIX,         column_argb_side##SUFFIX,   \
+        column_argb_side_fog##SUFFIX, column_indexed##SUFFIX,          column_indexed_fog##SUFFIX, \
+        column_indexed_side##SUFFIX,  column_indexed_side_fog##SUFFIX, column_shaded##SUFFIX,      \
+    };
+
+typedef void (*ColumnKernel)(void* pixels, int w, int x, const WallSpans* spans);
+
+DEFINE_COLUMN_KERNELS(_argb8888, RAYCAST_PIXEL_ARGB8888, false, false)
+DEFINE_COLUMN_KERNELS(_argb8888_lit, RAYCAST_PIXEL_ARGB8888, false, true)
+DEFINE_COLUMN_KERNELS(_argb8888_pot, RAYCAST_PIXEL_ARGB8888, true, false)
+DEFINE_COLUMN_KERNELS(_argb8888_pot_lit, RAYCAST_PIXEL_ARGB8888, true, true)
+DEFINE_COLUMN_KERNELS(_xrgb8888, RAYCAST_PIXEL_XRGB8888, false, false)
+DEFINE_COLUMN_KERNELS(_xrgb8888_lit, RAYCAST_PIXEL_XRGB8888, false, true)
+DEFINE_COLUMN_KERNELS(_xrgb8888_pot, RAYCAST_PIXEL_XRGB8888, true, false)
+DEFINE_COLUMN_KERNELS(_xrgb8888_pot_lit, RAYCAST_PIXEL_XRGB8888, true, true)
+DEFINE_COLUMN_KERNELS(_abgr8888, RAYCAST_PIXEL_ABGR8888, false, false)
+DEFINE_COLUMN_KERNELS(_abgr8888_lit, RAYCAST_PIXEL_ABGR8888, false, true)
+DEFINE_COLUMN_KERNELS(_abgr8888_pot, RAYCAST_PIXEL_ABGR8888, true, false)
+DEFINE_COLUMN_KERNELS(_abgr8888_pot_lit, RAYCAST_PIXEL_ABGR8888, true, true)
+DEFINE_COLUMN_KERNELS(_rgb565, RAYCAST_PIXEL_RGB565, false, false)
+DEFINE_COLUMN_KERNELS(_rgb565_lit, RAYCAST_PIXEL_RGB565, false, true)
+DEFINE_COLUMN_KERNELS(_rgb565_pot, RAYCAST_PIXEL_RGB565, true, false)
+DEFINE_COLUMN_KERNELS(_rgb565_pot_lit, RAYCAST_PIXEL_RGB565, true, true)
+
+// Indexed by [output format][power-of-two height][lit]
+static const ColumnKernel* const COLUMN_KERNELS[4][2][2] = {
+    { { column_kernels_argb8888, column_kernels_argb8888_lit },
+      { column_kernels_argb8888_pot, column_kernels_argb8888_pot_lit } },
+    { { column_kernels_xrgb8888, column_kernels_xrgb8888_lit },
+      { column_kernels_xrgb8888_pot, column_kernels_xrgb8888_pot_lit } },
+    { { column_kernels_abgr8888, column_kernels_abgr8888_lit },
+      { column_kernels_abgr8888_pot, column_kernels_abgr8888_pot_lit } },
+    { { column_kernels_rgb565, column_kernels_rgb565_lit },
+      { column_kernels_rgb565_pot, column_kernels_rgb565_pot_lit } },
+};
+
+/**
+ * @brief Check whether a pixel format has column kernels.
+ *
+ * The pixel format is a public Raycaster field, so renderers check it before indexing
+ * COLUMN_KERNELS with it.
+ *
+ * @param format The pixel format.
+ * @return true if format is one of the RaycastPixelFormat values.
+ */
+static inline bool pixel_format_valid(RaycastPixelFormat format) {
+    return (unsigned) format <= RAYCAST_PIXEL_RGB565;
+}
+
+/**
+ * @brief Pick the column kernel specialized for a textured wall column.
+ *
+ * @param spans The wall column, from wall_spans_init().
+ * @param format The output pixel format.
+ * @return The kernel to draw the column with.
+ */
+static inline ColumnKernel column_kernel(const WallSpans* spans, RaycastPixelFormat format) {
+    int variant = 8;
+    if (!spans->shades) {
+        variant
+            = (spans->texture->indices ? 4 : 0) + (spans->side == 1 ? 2 : 0) + (spans->fog ? 1 : 0);
+    }
+    return COLUMN_KERNELS[format][spans->shift >= 0][spans->light != NULL][variant];
+}
+
+/**
+ * @brief Blend rows [y0, y1) of one 32-bit framebuffer column toward a color.
+ *
+ * @param pixels Row-major framebuffer.
+ * @param w The width of the framebuffer.
+ * @param x The column to blend.
+ * @param y0 First row to blend.
+ * @param y1 One past the last row to blend.
+ * @param color The color to blend in, in the layout of the framebuffer.
+ * @param alpha Blend amount from 0 (unchanged) to 256 (color).
+ */
+static inline void
+blend_column(RaycastColor* pixels, int w, int x, int y0, int y1, RaycastColor color, int alpha) {
+    RaycastColor* pixel = pixels + (size_t) y0 * w + x;
+    for (int y = y0; y < y1; y++, pixel += w) {
+        *pixel = blend_color(*pixel, color, alpha);
+    }
+}
+
+/**
+ * @brief Blend rows [y0, y1) of one RGB565 framebuffer column toward a color.
+ *
+ * @param pixels Row-major framebuffer.
+ * @param w The width of the framebuffer.
+ * @param x The column to blend.
+ * @param y0 First row to blend.
+ * @param y1 One past the last row to blend.
+ * @param color The ARGB color to blend in.
+ * @param alpha Blend amount from 0 (unchanged) to 256 (color).
+ */
+static inline void
+blend_column16(uint16_t* pixels, int w, int x, int y0, int y1, RaycastColor color, int alpha) {
+    int       r   = (color >> 19) & 0x1F;
+    int       g   = (color >> 10) & 0x3F;
+    int       b   = (color >> 3) & 0x1F;
+    uint16_t* out = pixels + (size_t) y0 * w + x;
+    for (int y = y0; y < y1; y++, out += w) {
+        int pr = *out >> 11;
+        int pg = (*out >> 5) & 0x3F;
+        int pb = *out & 0x1F;
+        pr += ((r - pr) * alpha) >> 8;
+        pg += ((g - pg) * alpha) >> 8;
+        pb += ((b - pb) * alpha) >> 8;
+        *out = (uint16_t) ((pr << 11) | (pg << 5) | pb);
+    }
+}
+
+/**
+ * @brief Blend rows [y0, y1) of one framebuffer column toward a color by the color's alpha.
+ *
+ * @param pixels Row-major framebuffer in the given format.
+ * @param format The pixel format of the framebuffer.
+ * @param w The width of the framebuffer.
+ * @param x The column to blend.
+ * @param y0 First row to blend.
+ * @param y1 One past the last row to blend.
+ * @param color The ARGB color to blend in; alpha 0 leaves the column unchanged.
+ */
+static inline void blend_pixels(
+    void* pixels, RaycastPixelFormat format, int w, int x, int y0, int y1, RaycastColor color) {
+    int alpha = (int) ((uint32_t) color >> 24);
+    if (alpha == 0) {
+        return;
+    }
+    if (alpha == 0xFF) {
+        fill_pixels(pixels, format, w, x, y0, y1, color);
+        return;
+    }
+
+    alpha += alpha >> 7; // 0..255 to 0..256
+    if (format == RAYCAST_PIXEL_RGB565) {
+        blend_column16((uint16_t*) pixels, w, x, y0, y1, color, alpha);
+    } else {
+        RaycastColor pixel = (RaycastColor) convert_color(color, format);
+        blend_column((RaycastColor*) pixels, w, x, y0, y1, pixel, alpha);
+    }
+}
+
 /**
  * @brief Cast a ray from a point at a given angle and return the distance to the first non-black pixel.
  *
- * This function simulates raycasting by moving step-by-step from the starting point in the specified direction
- * until it hits a non-black pixel or goes out of bounds. It returns the distance traveled
- * from the starting point to the hit point.
+ * This function simulates raycasting by moving step-by-step from the starting point in the specified direction
+ * until it hits a non-black pixel or goes out of bounds. It returns the distance traveled
+ * from the starting point to the hit point.
+ *
+ * @param raycaster The Raycaster instance containing the map.
+ * @param x The x coordinate of the starting point.
+ * @param y The y coordinate of the starting point.
+ * @param angle The angle of the ray in degrees.
+ * @param hitColor Pointer to store the color of the hit pixel (if any).
+ *
+ * @return The distance to the first non-black pixel, or 0 if no hit is found.
+ */
+float raycast_cast(Raycaster* raycaster, float x, float y, float angle, RaycastColor* hitColor) {
+    RaycastHit hit;
+    if (cast_march(raycaster, x, y, angle, &hit)) {
+        *hitColor = hit.textureId;
+    }
+    return hit.distance;
+}
+
+/**
+ * @brief A ray traversed with DDA that can be resumed after each hit.
+ */
+typedef struct {
+    DdaState state;
+    float    x;
+    float    y;
+    float    dirX;
+    float    dirY;
+    float    maxDistance;
+    bool     started;
+} RayWalk;
+
+/**
+ * @brief Start a DDA ray from a point.
+ *
+ * @param raycaster The Raycaster instance containing the map.
+ * @param ray The ray to initialize.
+ * @param x The x coordinate of the starting point.
+ * @param y The y coordinate of the starting point.
+ * @param angle The angle of the ray in degrees.
+ */
+static inline void
+ray_begin(const Raycaster* raycaster, RayWalk* ray, float x, float y, float angle) {
+    float     radians = angle * (M_PI / 180.0f);
+    float     rayDirX = cosf(radians);
+    float     rayDirY = sinf(radians);
+    DdaState* state   = &ray->state;
+
+    ray->x            = x;
+    ray->y            = y;
+    ray->dirX         = rayDirX;
+    ray->dirY         = rayDirY;
+    ray->maxDistance  = (raycaster->maxDistance > 0.0f) ? raycaster->maxDistance : INFINITY;
+    ray->started      = false;
+
+    state->mapX       = (int) x;
+    state->mapY       = (int) y;
+    state->side       = 0;
+    state->deltaDistX = (rayDirX == 0) ? 1e30f : fabsf(1.0f / rayDirX);
+    state->deltaDistY = (rayDirY == 0) ? 1e30f : fabsf(1.0f / rayDirY);
+
+    if (rayDirX < 0) {
+        state->stepX     = -1;
+        state->sideDistX = (x - state->mapX) * state->deltaDistX;
+    } else {
+        state->stepX     = 1;
+        state->sideDistX = (state->mapX + 1.0f - x) * state->deltaDistX;
+    }
+
+    if (rayDirY < 0) {
+        state->stepY     = -1;
+        state->sideDistY = (y - state->mapY) * state->deltaDistY;
+    } else {
+        state->stepY     = 1;
+        state->sideDistY = (state->mapY + 1.0f - y) * state->deltaDistY;
+    }
+}
+
+/**
+ * @brief Continue a DDA ray to its next hit.
+ *
+ * Thin walls the ray misses are walked past. Calling again continues behind the last hit.
+ *
+ * @param raycaster The Raycaster instance containing the map.
+ * @param ray The ray.
+ * @param hit Filled with the hit information, or cleared if nothing more is hit.
+ * @return true if a wall was hit, false if the ray left the map or the view distance.
+ */
+static bool ray_next(const Raycaster* raycaster, RayWalk* ray, RaycastHit* hit) {
+    DdaState*              state = &ray->state;
+    const RaycastThinWall* wall  = NULL;
+
+    // A thin wall in the starting cell can still be ahead of the ray
+    if (!ray->started) {
+        ray->started = true;
+        if (state->mapX >= 0 && state->mapX < raycaster->width && state->mapY >= 0
+            && state->mapY < raycaster->height) {
+            wall = find_thin_wall(raycaster, state->mapY * raycaster->width + state->mapX);
+        }
+        if (wall && thin_wall_hit(raycaster, wall, ray->x, ray->y, ray->dirX, ray->dirY, hit)) {
+            return true;
+        }
+    }
+
+    // Perform DDA, walking on past thin walls the ray misses
+    do {
+        if (!dda_walk(raycaster, state, ray->maxDistance)) {
+            hit->distance  = 0.0f;
+            hit->wallX     = 0.0f;
+            hit->side      = 0;
+            hit->textureId = -1;
+            hit->cell      = -1;
+            return false;
+        }
+        wall = find_thin_wall(raycaster, state->mapY * raycaster->width + state->mapX);
+        if (wall && thin_wall_hit(raycaster, wall, ray->x, ray->y, ray->dirX, ray->dirY, hit)) {
+            return true;
+        }
+    } while (wall);
+
+    int   mapX = state->mapX;
+    int   mapY = state->mapY;
+    int   side = state->side;
+
+    float perpWallDist;
+    if (side == 0) {
+        perpWallDist = (mapX - ray->x + (1 - state->stepX) / 2) / ray->dirX;
+    } else {
+        perpWallDist = (mapY - ray->y + (1 - state->stepY) / 2) / ray->dirY;
+    }
+
+    float wallX;
+    if (side == 0) {
+        wallX = ray->y + perpWallDist * ray->dirY;
+    } else {
+        wallX = ray->x + perpWallDist * ray->dirX;
+    }
+    wallX -= floorf(wallX);
+
+    int cell       = mapY * raycaster->width + mapX;
+
+    hit->distance  = perpWallDist;
+    hit->wallX     = wallX;
+    hit->side      = side;
+    hit->textureId = cell_value(raycaster, cell);
+    hit->cell      = cell;
+    return true;
+}
+
+/**
+ * @brief Check whether what a ray hit can be seen through.
+ *
+ * A textured hit is translucent if its texture is flagged translucent (see
+ * raycast_texture_scan_alpha), a colored hit only if its cell type in a compact map is
+ * flagged translucent. Raw map colors are always opaque, whatever their alpha.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param hit The hit.
+ * @return true if walls behind the hit may show through it.
+ */
+static inline bool hit_translucent(const Raycaster* raycaster, const RaycastHit* hit) {
+    if (hit->textureId >= 0 && hit->textureId < raycaster->textureCount) {
+        return raycaster->textures[hit->textureId]->translucent;
+    }
+    return hit->cell >= 0 && raycaster->cellBits != 32
+           && raycaster->cellTypes[cell_raw(raycaster, hit->cell)].translucent;
+}
+
+/**
+ * @brief Check whether any wall of a Raycaster can be translucent.
+ *
+ * @param raycaster The Raycaster instance.
+ * @return true if a texture or a compact cell type is flagged translucent.
+ */
+static bool has_translucency(const Raycaster* raycaster) {
+    for (int i = 0; i < raycaster->textureCount; i++) {
+        if (raycaster->textures[i]->translucent) {
+            return true;
+        }
+    }
+    for (int i = 0; raycaster->cellBits != 32 && i < raycaster->cellTypeCount; i++) {
+        if (raycaster->cellTypes[i].translucent) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Look up the light table row of the wall face a ray hit.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param hit The hit.
+ * @param angle The angle of the ray in degrees.
+ * @return Row of RaycastLighting.table for the face, or NULL if the wall is unlit.
+ */
+static inline const uint8_t*
+hit_light(const Raycaster* raycaster, const RaycastHit* hit, float angle) {
+    const RaycastLighting* lighting = raycaster->lighting;
+    if (!lighting || hit->cell < 0 || lighting->width != raycaster->width
+        || lighting->height != raycaster->height) {
+        return NULL;
+    }
+
+    float       radians = angle * (M_PI / 180.0f);
+    RaycastFace face;
+    if (hit->side == 0) {
+        face = (cosf(radians) > 0.0f) ? RAYCAST_FACE_WEST : RAYCAST_FACE_EAST;
+    } else {
+        face = (sinf(radians) > 0.0f) ? RAYCAST_FACE_NORTH : RAYCAST_FACE_SOUTH;
+    }
+    return lighting->table[lighting->levels[hit->cell * 4 + face]];
+}
+
+/**
+ * @brief Cast a ray with texture information.
+ *
+ * This function performs DDA raycasting to find wall intersections and returns
+ * detailed hit information including texture coordinates.
  *
  * @param raycaster The Raycaster instance containing the map.
  * @param x The x coordinate of the starting point.
  * @param y The y coordinate of the starting point.
  * @param angle The angle of the ray in degrees.
- * @param hitColor Pointer to store the color of the hit pixel (if any).
+ * @param hit Pointer to store the hit information.
+ */
+void raycast_cast_textured(Raycaster* raycaster, float x, float y, float angle, RaycastHit* hit) {
+    RayWalk ray;
+    ray_begin(raycaster, &ray, x, y, angle);
+    ray_next(raycaster, &ray, hit);
+}
+
+/**
+ * @brief Cast a ray through translucent walls, collecting every layer it sees.
+ *
+ * The ray continues behind hits that are translucent and stops at the first opaque one. The
+ * nearest RAYCAST_MAX_HITS - 1 translucent hits are kept; further ones are skipped so the
+ * opaque wall behind them always fits.
+ *
+ * @param raycaster The Raycaster instance containing the map.
+ * @param x The x coordinate of the starting point.
+ * @param y The y coordinate of the starting point.
+ * @param angle The angle of the ray in degrees.
+ * @param hits Filled with the hits, nearest first; the last one is opaque unless the ray left
+ *             the map or the view distance behind a translucent hit.
+ */
+void raycast_cast_layers(
+    Raycaster* raycaster, float x, float y, float angle, RaycastHitList* hits) {
+    RayWalk    ray;
+    RaycastHit hit;
+    hits->count = 0;
+    ray_begin(raycaster, &ray, x, y, angle);
+    while (ray_next(raycaster, &ray, &hit)) {
+        bool translucent = hit_translucent(raycaster, &hit);
+        if (!translucent || hits->count < RAYCAST_MAX_HITS - 1) {
+            hits->hits[hits->count++] = hit;
+        }
+        if (!translucent) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Make room for one more element in a Raycaster-owned array.
+ *
+ * Capacity doubles on every growth, so adding n elements costs O(log n) allocations.
+ * Arrays of arena-backed Raycasters are moved within the arena; the old copy is
+ * reclaimed when the arena is reset.
+ *
+ * @param raycaster The Raycaster owning the array.
+ * @param array The array, or NULL.
+ * @param count Number of elements in use.
+ * @param capacity Number of elements allocated; updated on growth.
+ * @param size Size of one element.
+ * @return The (possibly moved) array, or NULL on allocation failure.
+ */
+static void* grow_array(Raycaster* raycaster, void* array, int count, int* capacity, size_t size) {
+    if (array && count < *capacity) {
+        return array;
+    }
+
+    int   newCapacity = (*capacity > count) ? *capacity : ((count > 0) ? count * 2 : 8);
+    void* newArray;
+    if (raycaster->arena) {
+        newArray = raycast_arena_alloc(raycaster->arena, newCapacity * size);
+        if (newArray && array) {
+            memcpy(newArray, array, count * size);
+        }
+    } else {
+        newArray = realloc(array, newCapacity * size);
+    }
+
+    if (newArray) {
+        *capacity = newCapacity;
+    }
+    return newArray;
+}
+
+/**
+ * @brief Free the map, cell type table and thin walls of a Raycaster unless they live in an
+ * arena.
+ *
+ * @param raycaster The Raycaster instance.
+ */
+static void free_map(Raycaster* raycaster) {
+    if (!raycaster->arena) {
+        if (raycaster->map) {
+            free(raycaster->map);
+        }
+        free(raycaster->cells);
+        free(raycaster->cellTypes);
+        free(raycaster->thinWalls);
+    }
+    raycaster->map              = NULL;
+    raycaster->cells            = NULL;
+    raycaster->cellTypes        = NULL;
+    raycaster->cellTypeCount    = 0;
+    raycaster->cellTypeCapacity = 0;
+    raycaster->thinWalls        = NULL;
+    raycaster->thinWallCount    = 0;
+    raycaster->thinWallCapacity = 0;
+}
+
+/**
+ * @brief Start a new map: edits recorded so far no longer describe it.
+ *
+ * @param raycaster The Raycaster instance.
+ */
+static void reset_edits(Raycaster* raycaster) {
+    raycaster->rows = NULL;
+    raycaster->revision++;
+    raycaster->editBase = raycaster->revision;
+}
+
+/**
+ * @brief Record a changed rectangle of cells in the edit journal.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param x First column.
+ * @param y First row.
+ * @param w Number of columns.
+ * @param h Number of rows.
+ */
+static void record_edit(Raycaster* raycaster, int x, int y, int w, int h) {
+    raycaster->revision++;
+    raycaster->edits[raycaster->revision % RAYCAST_EDIT_JOURNAL] = (RaycastRect){ x, y, w, h };
+}
+
+/**
+ * @brief Create a new texture.
+ *
+ * @param width Width of the texture.
+ * @param height Height of the texture.
+ * @return The newly allocated texture, or NULL on failure.
+ */
+RaycastTexture* raycast_texture_create(int width, int height) {
+    if (width <= 0 || height <= 0 || width > INT_MAX / height) {
+        return NULL;
+    }
+
+    RaycastTexture* texture = (RaycastTexture*) calloc(1, sizeof(RaycastTexture));
+    if (!texture) {
+        return NULL;
+    }
+
+    texture->pixels = (RaycastColor*) calloc((size_t) width * height, sizeof(RaycastColor));
+    if (!texture->pixels) {
+        free(texture);
+        return NULL;
+    }
+
+    texture->width  = width;
+    texture->height = height;
+    return texture;
+}
+
+/**
+ * @brief Create a new texture inside an arena.
+ *
+ * The texture header and its 64-byte aligned pixels are placed back to back in the arena.
+ * The texture is released with the arena; raycast_texture_destroy() leaves it alone. If the
+ * pixels do not fit, the header is handed back to the arena as well.
+ *
+ * @param arena The arena to allocate from.
+ * @param width Width of the texture.
+ * @param height Height of the texture.
+ * @return The newly allocated texture, or NULL if the size is invalid or the arena is full.
+ */
+RaycastTexture* raycast_texture_create_arena(RaycastArena* arena, int width, int height) {
+    if (width <= 0 || height <= 0 || width > INT_MAX / height) {
+        return NULL;
+    }
+
+    size_t          mark    = arena->used;
+    RaycastTexture* texture = (RaycastTexture*) raycast_arena_alloc(arena, sizeof(RaycastTexture));
+    if (!texture) {
+        return NULL;
+    }
+
+    texture->pixels
+        = (RaycastColor*) raycast_arena_alloc(arena,
+                                              (size_t) width * height * sizeof(RaycastColor));
+    if (!texture->pixels) {
+        arena->used = mark;
+        return NULL;
+    }
+
+    texture->width      = width;
+    texture->height     = height;
+    texture->arenaOwned = 1;
+    return texture;
+}
+
+/**
+ * @brief Destroy a texture.
+ *
+ * @param texture The texture to destroy.
+ */
+void raycast_texture_destroy(RaycastTexture* texture) {
+    if (texture && !texture->arenaOwned) {
+        if (texture->pixels) {
+            free(texture->pixels);
+        }
+        free(texture->indices);
+        if (texture->ownsPalette) {
+            raycast_palette_destroy(texture->palette);
+        }
+        free(texture);
+    }
+}
+
+/**
+ * @brief Create a new indexed texture.
+ *
+ * Indexed textures store one byte per texel, which keeps many large textures in cache.
+ * The palette is not copied; it may be shared between textures and must outlive them.
+ *
+ * @param width Width of the texture.
+ * @param height Height of the texture.
+ * @param palette The palette to use.
+ * @return The newly allocated texture, or NULL on failure.
+ */
+RaycastTexture* raycast_texture_create_indexed(int width, int height, RaycastPalette* palette) {
+    if (!palette || width <= 0 || height <= 0 || width > INT_MAX / height) {
+        return NULL;
+    }
+
+    RaycastTexture* texture = (RaycastTexture*) calloc(1, sizeof(RaycastTexture));
+    if (!texture) {
+        return NULL;
+    }
+
+    texture->indices = (uint8_t*) calloc((size_t) width * height, sizeof(uint8_t));
+    if (!texture->indices) {
+        free(texture);
+        return NULL;
+    }
+
+    texture->width   = width;
+    texture->height  = height;
+    texture->palette = palette;
+    return texture;
+}
+
+/**
+ * @brief Get the squared distance between two ARGB colors.
+ *
+ * @param a The first color.
+ * @param b The second color.
+ * @return The sum of squared channel differences.
+ */
+static int color_distance(RaycastColor a, RaycastColor b) {
+    int distance = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        int d = ((a >> shift) & 0xFF) - ((b >> shift) & 0xFF);
+        distance += d * d;
+    }
+    return distance;
+}
+
+/**
+ * @brief Find the palette entry closest to a color.
+ *
+ * @param palette The palette to search.
+ * @param count Number of palette entries in use.
+ * @param color The color to look up.
+ * @return Index of the closest palette entry.
+ */
+static int palette_nearest(const RaycastPalette* palette, int count, RaycastColor color) {
+    int best         = 0;
+    int bestDistance = INT_MAX;
+    for (int i = 0; i < count && bestDistance > 0; i++) {
+        int distance = color_distance(palette->colors[i], color);
+        if (distance < bestDistance) {
+            best         = i;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+#define COLOR_TABLE_BITS 9
+#define COLOR_TABLE_SIZE (1 << COLOR_TABLE_BITS)
+
+/**
+ * @brief Open addressing hash table mapping the colors of an exact palette to their indices.
+ */
+typedef struct {
+    RaycastColor colors[COLOR_TABLE_SIZE];
+    int16_t      indices[COLOR_TABLE_SIZE]; // -1 for an empty slot
+    int          count; // Colors stored, or -1 if the palette is not exact
+} ColorTable;
+
+/**
+ * @brief Find the slot of a color in a color table.
+ *
+ * @param table The color table.
+ * @param color The color to look up.
+ * @return The slot holding the color, or the empty slot it would go in.
+ */
+static int color_table_slot(const ColorTable* table, RaycastColor color) {
+    int slot = (int) (((uint32_t) color * 0x9E3779B1u) >> (32 - COLOR_TABLE_BITS));
+    while (table->indices[slot] >= 0 && table->colors[slot] != color) {
+        slot = (slot + 1) & (COLOR_TABLE_SIZE - 1);
+    }
+    return slot;
+}
+
+/**
+ * @brief Build a palette for an ARGB texture.
+ *
+ * Textures with at most 256 distinct colors get an exact palette, found with one hash
+ * lookup per texel. Otherwise colors are bucketed by their top 4 bits per channel and the
+ * 256 most common buckets are used, each represented by the average of its colors.
+ *
+ * @param src The ARGB texture.
+ * @param palette The palette to fill.
+ * @param table Filled with the palette index of every color for an exact palette; count is
+ *              -1 otherwise.
+ * @return 0 on success, 1 on memory allocation failure.
+ */
+static int
+palette_from_texture(const RaycastTexture* src, RaycastPalette* palette, ColorTable* table) {
+    int size     = src->width * src->height;
+    table->count = 0;
+    memset(table->indices, 0xFF, sizeof(table->indices));
+    for (int i = 0; i < size; i++) {
+        RaycastColor color = src->pixels[i];
+        int          slot  = color_table_slot(table, color);
+        if (table->indices[slot] < 0) {
+            if (table->count == RAYCAST_PALETTE_SIZE) {
+                table->count = -1;
+                break;
+            }
+            table->colors[slot]             = color;
+            table->indices[slot]            = (int16_t) table->count;
+            palette->colors[table->count++] = color;
+        }
+    }
+    if (table->count >= 0) {
+        return 0;
+    }
+
+    // Too many colors: keep the most common ARGB4444 buckets (one count and four channel sums)
+    uint32_t* buckets = (uint32_t*) calloc(65536 * 5, sizeof(uint32_t));
+    if (!buckets) {
+        return 1;
+    }
+    uint32_t* counts = buckets;
+    uint32_t* sums   = buckets + 65536;
+    for (int i = 0; i < size; i++) {
+        uint32_t color = (uint32_t) src->pixels[i];
+        int      key = ((color >> 16) & 0xF000) | ((color >> 12) & 0x0F00) | ((color >> 8) & 0x00F0)
+                  | ((color >> 4) & 0x000F);
+        counts[key]++;
+        for (int c = 0; c < 4; c++) {
+            sums[c * 65536 + key] += (color >> (c * 8)) & 0xFF;
+        }
+    }
+
+    for (int n = 0; n < RAYCAST_PALETTE_SIZE; n++) {
+        int best = -1;
+        for (int key = 0; key < 65536; key++) {
+            if (counts[key] && (best < 0 || counts[key] > counts[best])) {
+                best = key;
+            }
+        }
+        if (best < 0) {
+            palette->colors[n] = 0;
+            continue;
+        }
+        uint32_t color = 0;
+        for (int c = 0; c < 4; c++) {
+            color |= (sums[c * 65536 + best] / counts[best]) << (c * 8);
+        }
+        palette->colors[n] = (RaycastColor) color;
+        counts[best]       = 0;
+    }
+
+    free(buckets);
+    return 0;
+}
+
+/**
+ * @brief Find the palette index a texel maps to.
  *
- * @return The distance to the first non-black pixel, or 0 if no hit is found.
+ * @param table The color table of an exact palette, or one with a count of -1.
+ * @param palette The palette to search when the table is not exact.
+ * @param color The texel color.
+ * @return The index of the color in an exact palette, otherwise of the closest entry.
  */
-float raycast_cast(Raycaster* raycaster, float x, float y, float angle, RaycastColor* hitColor) {
-    float currentX = x;
-    float currentY = y;
-    while (currentX >= 0 && currentX < raycaster->width && currentY >= 0
-           && currentY < raycaster->height) {
-        int mapX = (int) currentX;
-        int mapY = (int) currentY;
-        if (raycaster->map[mapY * raycaster->width + mapX] != -1) {
-            float dx  = currentX - x;
-            float dy  = currentY - y;
-            *hitColor = raycaster->map[mapY * raycaster->width + mapX];
-            return sqrtf(dx * dx + dy * dy);
-        }
-        currentX += cosf(angle * (M_PI / 180.0f));
-        currentY += sinf(angle * (M_PI / 180.0f));
+static int texel_index(const ColorTable* table, const RaycastPalette* palette, RaycastColor color) {
+    if (table->count >= 0) {
+        return table->indices[color_table_slot(table, color)];
     }
-    return 0.0f;
+    return palette_nearest(palette, RAYCAST_PALETTE_SIZE, color);
 }
 
 /**
- * @brief Cast a ray with texture information.
+ * @brief Convert an ARGB texture to an indexed texture.
  *
- * This function performs DDA raycasting to find wall intersections and returns
- * detailed hit information including texture coordinates.
+ * If no palette is given, a palette is built from the texture's colors and owned by the
+ * new texture. Otherwise every texel is mapped to the closest entry of the given palette,
+ * which lets many textures share one palette.
  *
- * @param raycaster The Raycaster instance containing the map.
- * @param x The x coordinate of the starting point.
- * @param y The y coordinate of the starting point.
- * @param angle The angle of the ray in degrees.
- * @param hit Pointer to store the hit information.
+ * @param src The ARGB texture to convert.
+ * @param palette The palette to map to, or NULL to build one.
+ * @return The newly allocated indexed texture, or NULL on failure.
  */
-void raycast_cast_textured(Raycaster* raycaster, float x, float y, float angle, RaycastHit* hit) {
-    float radians    = angle * (M_PI / 180.0f);
-    float rayDirX    = cosf(radians);
-    float rayDirY    = sinf(radians);
-
-    int   mapX       = (int) x;
-    int   mapY       = (int) y;
-
-    float deltaDistX = (rayDirX == 0) ? 1e30f : fabsf(1.0f / rayDirX);
-    float deltaDistY = (rayDirY == 0) ? 1e30f : fabsf(1.0f / rayDirY);
-
-    int   stepX;
-    int   stepY;
-    float sideDistX;
-    float sideDistY;
-
-    if (rayDirX < 0) {
-        stepX     = -1;
-        sideDistX = (x - mapX) * deltaDistX;
-    } else {
-        stepX     = 1;
-        sideDistX = (mapX + 1.0f - x) * deltaDistX;
+RaycastTexture* raycast_texture_to_indexed(const RaycastTexture* src, RaycastPalette* palette) {
+    if (!src || !src->pixels) {
+        return NULL;
     }
 
-    if (rayDirY < 0) {
-        stepY     = -1;
-        sideDistY = (y - mapY) * deltaDistY;
-    } else {
-        stepY     = 1;
-        sideDistY = (mapY + 1.0f - y) * deltaDistY;
-    }
-
-    // Perform DDA
-    int  side     = 0;
-    bool hitWall  = false;
-    int  maxSteps = raycaster->width + raycaster->height;
-    for (int i = 0; i < maxSteps && !hitWall; i++) {
-        if (sideDistX < sideDistY) {
-            sideDistX += deltaDistX;
-            mapX += stepX;
-            side = 0;
-        } else {
-            sideDistY += deltaDistY;
-            mapY += stepY;
-            side = 1;
-        }
+    ColorTable table       = { .count = -1 };
+    int        ownsPalette = !palette;
+    if (ownsPalette && !(palette = raycast_palette_create(NULL, 0))) {
+        return NULL;
+    }
+    if (ownsPalette && palette_from_texture(src, palette, &table)) {
+        raycast_palette_destroy(palette);
+        return NULL;
+    }
 
-        if (mapX < 0 || mapX >= raycaster->width || mapY < 0 || mapY >= raycaster->height) {
-            break;
+    RaycastTexture* texture = raycast_texture_create_indexed(src->width, src->height, palette);
+    if (!texture) {
+        if (ownsPalette) {
+            raycast_palette_destroy(palette);
         }
+        return NULL;
+    }
+    texture->ownsPalette = ownsPalette;
+    texture->translucent = src->translucent;
 
-        if (raycaster->map[mapY * raycaster->width + mapX] != RAYCAST_EMPTY) {
-            hitWall = true;
+    // Consecutive texels are often equal, so remember the last lookup; exact palettes map
+    // through the color table instead of searching the palette
+    RaycastColor last      = src->pixels[0];
+    int          lastIndex = texel_index(&table, palette, last);
+    for (int i = 0; i < src->width * src->height; i++) {
+        if (src->pixels[i] != last) {
+            last      = src->pixels[i];
+            lastIndex = texel_index(&table, palette, last);
         }
+        texture->indices[i] = (uint8_t) lastIndex;
     }
 
-    if (!hitWall) {
-        hit->distance  = 0.0f;
-        hit->wallX     = 0.0f;
-        hit->side      = 0;
-        hit->textureId = -1;
-        return;
-    }
+    return texture;
+}
 
-    float perpWallDist;
-    if (side == 0) {
-        perpWallDist = (mapX - x + (1 - stepX) / 2) / rayDirX;
-    } else {
-        perpWallDist = (mapY - y + (1 - stepY) / 2) / rayDirY;
+/**
+ * @brief Flag a texture as translucent if any of its texels has an alpha below 255.
+ *
+ * Translucent textures are composited over the walls behind them by the buffer renderers.
+ * Call this after filling the pixels of a texture that uses alpha; raycast_texture_load()
+ * does it for loaded images.
+ *
+ * @param texture The texture to scan.
+ * @return Whether the texture is translucent.
+ */
+bool raycast_texture_scan_alpha(RaycastTexture* texture) {
+    if (!texture) {
+        return false;
     }
 
-    float wallX;
-    if (side == 0) {
-        wallX = y + perpWallDist * rayDirY;
-    } else {
-        wallX = x + perpWallDist * rayDirX;
+    texture->translucent = 0;
+    for (int i = 0; i < texture->width * texture->height && !texture->translucent; i++) {
+        RaycastColor color
+            = texture->indices ? texture->palette->colors[texture->indices[i]] : texture->pixels[i];
+        texture->translucent = ((uint32_t) color >> 24) != 0xFF;
     }
-    wallX -= floorf(wallX);
-
-    int textureId  = raycaster->map[mapY * raycaster->width + mapX];
-
-    hit->distance  = perpWallDist;
-    hit->wallX     = wallX;
-    hit->side      = side;
-    hit->textureId = textureId;
+    return texture->translucent;
 }
 
 /**
- * @brief Create a new texture.
+ * @brief Create a palette.
  *
- * @param width Width of the texture.
- * @param height Height of the texture.
- * @return The newly allocated texture, or NULL on failure.
+ * @param colors Initial ARGB colors, or NULL.
+ * @param count Number of initial colors (at most RAYCAST_PALETTE_SIZE); the rest are zeroed.
+ * @return The newly allocated palette, or NULL on failure.
  */
-RaycastTexture* raycast_texture_create(int width, int height) {
-    RaycastTexture* texture = (RaycastTexture*) malloc(sizeof(RaycastTexture));
-    if (!texture) {
+RaycastPalette* raycast_palette_create(const RaycastColor* colors, int count) {
+    RaycastPalette* palette = (RaycastPalette*) calloc(1, sizeof(RaycastPalette));
+    if (!palette) {
         return NULL;
     }
 
-    texture->pixels = (RaycastColor*) calloc(width * height, sizeof(RaycastColor));
-    if (!texture->pixels) {
-        free(texture);
-        return NULL;
+    if (colors) {
+        if (count > RAYCAST_PALETTE_SIZE) {
+            count = RAYCAST_PALETTE_SIZE;
+        }
+        memcpy(palette->colors, colors, count * sizeof(RaycastColor));
     }
+    return palette;
+}
 
-    texture->width  = width;
-    texture->height = height;
-    return texture;
+/**
+ * @brief Destroy a palette.
+ *
+ * @param palette The palette to destroy.
+ */
+void raycast_palette_destroy(RaycastPalette* palette) {
+    if (palette) {
+        free(palette->shades);
+        free(palette);
+    }
 }
 
 /**
- * @brief Destroy a texture.
+ * @brief Precompute side-shaded and fogged variants of a palette.
  *
- * @param texture The texture to destroy.
+ * Once built, walls using indexed textures with this palette are shaded and fogged by
+ * picking a palette variant per column instead of blending every pixel. The shades must
+ * be rebuilt after the palette colors or the Raycaster's fog color change; until then
+ * rendering falls back to per-pixel shading.
+ *
+ * @param palette The palette.
+ * @param fogColor The fog color to build the shades for.
+ * @return 0 on success, 1 on memory allocation failure.
  */
-void raycast_texture_destroy(RaycastTexture* texture) {
-    if (texture) {
-        if (texture->pixels) {
-            free(texture->pixels);
+int raycast_palette_build_shades(RaycastPalette* palette, RaycastColor fogColor) {
+    if (!palette->shades) {
+        palette->shades = (RaycastColor*) malloc(2 * RAYCAST_FOG_LEVELS * RAYCAST_PALETTE_SIZE
+                                                 * sizeof(RaycastColor));
+        if (!palette->shades) {
+            return 1;
+        }
+    }
+
+    for (int side = 0; side < 2; side++) {
+        for (int level = 0; level < RAYCAST_FOG_LEVELS; level++) {
+            int           fog = (level * 256) / (RAYCAST_FOG_LEVELS - 1);
+            RaycastColor* shade
+                = palette->shades + (side * RAYCAST_FOG_LEVELS + level) * RAYCAST_PALETTE_SIZE;
+            for (int i = 0; i < RAYCAST_PALETTE_SIZE; i++) {
+                RaycastColor color = palette->colors[i];
+                if (side == 1) {
+                    color = shade_side(color);
+                }
+                shade[i] = blend_color(color, fogColor, fog);
+            }
         }
-        free(texture);
     }
+
+    palette->shadeFogColor = fogColor;
+    return 0;
 }
 
 /**
@@ -188,9 +1818,11 @@ void raycast_add_texture(Raycaster* raycaster, RaycastTexture* texture) {
         return;
     }
 
-    RaycastTexture** newTextures
-        = (RaycastTexture**) realloc(raycaster->textures,
-                                     (raycaster->textureCount + 1) * sizeof(RaycastTexture*));
+    RaycastTexture** newTextures = (RaycastTexture**) grow_array(raycaster,
+                                                                 raycaster->textures,
+                                                                 raycaster->textureCount,
+                                                                 &raycaster->textureCapacity,
+                                                                 sizeof(RaycastTexture*));
 
     if (!newTextures) {
         return;
@@ -201,11 +1833,141 @@ void raycast_add_texture(Raycaster* raycaster, RaycastTexture* texture) {
     raycaster->textureCount++;
 }
 
+/**
+ * @brief Add a cell type to a compact map's cell type table.
+ *
+ * @param raycaster The raycaster instance.
+ * @param type The cell type to add.
+ * @return The ID of the new cell type, or -1 if the map is not compact, the table is full
+ *         or memory allocation failed.
+ */
+int raycast_add_cell_type(Raycaster* raycaster, const RaycastCellType* type) {
+    if (!raycaster || !type || (raycaster->cellBits != 8 && raycaster->cellBits != 16)
+        || raycaster->cellTypeCount >= (1 << raycaster->cellBits)) {
+        return -1;
+    }
+
+    RaycastCellType* newTypes = (RaycastCellType*) grow_array(raycaster,
+                                                              raycaster->cellTypes,
+                                                              raycaster->cellTypeCount,
+                                                              &raycaster->cellTypeCapacity,
+                                                              sizeof(RaycastCellType));
+    if (!newTypes) {
+        return -1;
+    }
+
+    raycaster->cellTypes                           = newTypes;
+    raycaster->cellTypes[raycaster->cellTypeCount] = *type;
+    return raycaster->cellTypeCount++;
+}
+
+/**
+ * @brief Give a map cell a thin wall or door, replacing any it already has.
+ *
+ * The cell itself must be non-empty; its texture or color is drawn on the panel. Pointers
+ * returned by raycast_get_thin_wall() are invalidated.
+ *
+ * @param raycaster The raycaster instance.
+ * @param x The x coordinate of the cell.
+ * @param y The y coordinate of the cell.
+ * @param wall The thin wall (its cell field is ignored).
+ * @return 0 on success, 1 if the cell is outside the map or memory allocation failed.
+ */
+int raycast_set_thin_wall(Raycaster* raycaster, int x, int y, const RaycastThinWall* wall) {
+    if (!raycaster || !wall || x < 0 || x >= raycaster->width || y < 0 || y >= raycaster->height) {
+        return 1;
+    }
+
+    int index = y * raycaster->width + x;
+    int slot  = thin_wall_slot(raycaster, index);
+    if (slot >= raycaster->thinWallCount || raycaster->thinWalls[slot].cell != index) {
+        RaycastThinWall* newWalls = (RaycastThinWall*) grow_array(raycaster,
+                                                                  raycaster->thinWalls,
+                                                                  raycaster->thinWallCount,
+                                                                  &raycaster->thinWallCapacity,
+                                                                  sizeof(RaycastThinWall));
+        if (!newWalls) {
+            return 1;
+        }
+        raycaster->thinWalls = newWalls;
+        memmove(&newWalls[slot + 1],
+                &newWalls[slot],
+                (raycaster->thinWallCount - slot) * sizeof(RaycastThinWall));
+        raycaster->thinWallCount++;
+    }
+
+    raycaster->thinWalls[slot]      = *wall;
+    raycaster->thinWalls[slot].cell = index;
+    record_edit(raycaster, x, y, 1, 1);
+    return 0;
+}
+
+/**
+ * @brief Remove the thin walls of every cell in a rectangle.
+ *
+ * @param raycaster The raycaster instance.
+ * @param x0 First column.
+ * @param y0 First row.
+ * @param x1 One past the last column.
+ * @param y1 One past the last row.
+ */
+static void remove_thin_walls(Raycaster* raycaster, int x0, int y0, int x1, int y1) {
+    int kept = 0;
+    for (int i = 0; i < raycaster->thinWallCount; i++) {
+        int x = raycaster->thinWalls[i].cell % raycaster->width;
+        int y = raycaster->thinWalls[i].cell / raycaster->width;
+        if (x < x0 || x >= x1 || y < y0 || y >= y1) {
+            raycaster->thinWalls[kept++] = raycaster->thinWalls[i];
+        }
+    }
+    raycaster->thinWallCount = kept;
+}
+
+/**
+ * @brief Remove the thin wall of a map cell, turning it back into a full block.
+ *
+ * @param raycaster The raycaster instance.
+ * @param x The x coordinate of the cell.
+ * @param y The y coordinate of the cell.
+ */
+void raycast_remove_thin_wall(Raycaster* raycaster, int x, int y) {
+    if (!raycaster || x < 0 || x >= raycaster->width || y < 0 || y >= raycaster->height) {
+        return;
+    }
+
+    int index = y * raycaster->width + x;
+    int slot  = thin_wall_slot(raycaster, index);
+    if (slot < raycaster->thinWallCount && raycaster->thinWalls[slot].cell == index) {
+        memmove(&raycaster->thinWalls[slot],
+                &raycaster->thinWalls[slot + 1],
+                (raycaster->thinWallCount - slot - 1) * sizeof(RaycastThinWall));
+        raycaster->thinWallCount--;
+        record_edit(raycaster, x, y, 1, 1);
+    }
+}
+
+/**
+ * @brief Get the thin wall of a map cell, e.g. to animate a door through its open field.
+ *
+ * @param raycaster The raycaster instance.
+ * @param x The x coordinate of the cell.
+ * @param y The y coordinate of the cell.
+ * @return The thin wall, valid until thin walls are added or removed, or NULL if the cell has
+ *         none.
+ */
+RaycastThinWall* raycast_get_thin_wall(Raycaster* raycaster, int x, int y) {
+    if (!raycaster || x < 0 || x >= raycaster->width || y < 0 || y >= raycaster->height) {
+        return NULL;
+    }
+    return find_thin_wall(raycaster, y * raycaster->width + x);
+}
+
 /**
  * @brief Check if a point collides with an occupied pixel in the Raycaster map.
  *
  * This function checks if the given point is within the bounds of the Raycaster map and
- * if the corresponding pixel is not empty (i.e., it is occupied).
+ * if the corresponding pixel is not empty (i.e., it is occupied). A cell with a thin wall
+ * blocks until its door is fully open.
  *
  * @param raycaster The Raycaster instance containing the map.
  * @param x The x coordinate to check for collision.
@@ -216,56 +1978,108 @@ bool raycast_collides(Raycaster* raycaster, float x, float y) {
     if (x < 0 || x >= raycaster->width || y < 0 || y >= raycaster->height) {
         return true;
     }
-    int mapX = (int) x;
-    int mapY = (int) y;
-    if (raycaster->map[mapY * raycaster->width + mapX] != -1) {
-        return true;
+    int  mapX  = (int) x;
+    int  mapY  = (int) y;
+    int  index = mapY * raycaster->width + mapX;
+    int  raw   = cell_raw(raycaster, index);
+    bool solid = (raycaster->cellBits == 32) ? raw != -1 : raycaster->cellTypes[raw].solid != 0;
+    if (solid && raycaster->thinWallCount > 0) {
+        const RaycastThinWall* wall = find_thin_wall(raycaster, index);
+        if (wall) {
+            return wall->open < 1.0f;
+        }
     }
-    return false;
+    return solid;
 }
 
 /**
  * @brief Destroy a Raycaster instance.
  *
  * This function frees the memory allocated for the Raycaster instance and its map.
+ * Memory that lives in an arena is left for raycast_arena_destroy() or raycast_arena_reset().
  *
  * @param raycaster The Raycaster instance to destroy.
  */
 void raycast_destroy(Raycaster* raycaster) {
     if (raycaster) {
-        if (raycaster->map) {
-            free(raycaster->map);
-        }
+        free_map(raycaster);
         if (raycaster->textures) {
             for (int i = 0; i < raycaster->textureCount; i++) {
                 raycast_texture_destroy(raycaster->textures[i]);
             }
-            free(raycaster->textures);
+            if (!raycaster->arena) {
+                free(raycaster->textures);
+            }
+        }
+        if (!raycaster->arena) {
+            free(raycaster);
         }
-        free(raycaster);
     }
 }
 
+/**
+ * @brief Fill the clipped cells of a rectangle in a map of one cell type.
+ */
+#define FILL_RECT(TYPE, CELLS, VALUE)                                                              \
+    do {                                                                                           \
+        TYPE* cells = (TYPE*) (CELLS);                                                             \
+        for (int i = i0; i < i1; i++) {                                                            \
+            int row = ((int) rect->y + i) * raycaster->width + (int) rect->x;                      \
+            for (int j = j0; j < j1; j++) {                                                        \
+                cells[row + j] = (TYPE) (VALUE);                                                   \
+            }                                                                                      \
+        }                                                                                          \
+    } while (0)
+
 /**
  * @brief Draw a rectangle on the Raycaster map.
  *
  * This function fills a rectangle area on the Raycaster map with the specified color.
  * If the rectangle exceeds the bounds of the map, it will be clipped accordingly.
+ * On compact maps, color is the cell type ID to fill with (RAYCAST_EMPTY erases).
  *
  * @param raycaster The Raycaster instance to draw on.
  * @param rect The rectangle to draw, defined by its top-left point and size.
  * @param color The color to fill the rectangle with.
+ * @return 0 on success, 1 if color is not a cell type ID of a compact map (nothing is drawn).
  */
-void raycast_draw(Raycaster* raycaster, const RaycastRect* rect, const RaycastColor* color) {
-    for (int i = 0; i < rect->h; i++) {
-        for (int j = 0; j < rect->w; j++) {
-            if (rect->x + j < 0 || rect->x + j >= raycaster->width || rect->y + i < 0
-                || rect->y + i >= raycaster->height) {
-                continue;
-            }
-            raycaster->map[((int) rect->y + i) * raycaster->width + ((int) rect->x + j)] = *color;
-        }
+int raycast_draw(Raycaster* raycaster, const RaycastRect* rect, const RaycastColor* color) {
+    // Clip once up front: row i / column j is inside the map if y + i / x + j is
+    int i0 = (rect->y < 0) ? (int) ceilf(-rect->y) : 0;
+    int j0 = (rect->x < 0) ? (int) ceilf(-rect->x) : 0;
+    int i1 = (int) ceilf(fminf(rect->h, raycaster->height - rect->y));
+    int j1 = (int) ceilf(fminf(rect->w, raycaster->width - rect->x));
+    int id = (*color == RAYCAST_EMPTY) ? RAYCAST_CELL_EMPTY : *color;
+    if (raycaster->cellBits != 32
+        && (id < 0 || id >= raycaster->cellTypeCount || id >= (1 << raycaster->cellBits))) {
+        return 1;
+    }
+    if (i1 <= i0 || j1 <= j0) {
+        return 0;
+    }
+
+    switch (raycaster->cellBits) {
+    case 8:
+        FILL_RECT(uint8_t, raycaster->cells, id);
+        break;
+    case 16:
+        FILL_RECT(uint16_t, raycaster->cells, id);
+        break;
+    default:
+        FILL_RECT(RaycastColor, raycaster->map, *color);
+        break;
+    }
+
+    // Empty cells cannot hold a panel
+    bool empty = (raycaster->cellBits == 32) ? *color == RAYCAST_EMPTY : id == RAYCAST_CELL_EMPTY;
+    if (empty && raycaster->thinWallCount > 0) {
+        int x0 = (int) rect->x + j0;
+        int y0 = (int) rect->y + i0;
+        remove_thin_walls(raycaster, x0, y0, x0 + j1 - j0, y0 + i1 - i0);
     }
+
+    record_edit(raycaster, (int) rect->x + j0, (int) rect->y + i0, j1 - j0, i1 - i0);
+    return 0;
 }
 
 /**
@@ -276,28 +2090,212 @@ void raycast_draw(Raycaster* raycaster, const RaycastRect* rect, const RaycastCo
  * @param raycaster The Raycaster instance to erase from.
  * @param rect The rectangle area to erase, defined by its top-left point and size.
  */
-void raycast_erase(Raycaster* raycaster, const RaycastRect* rect) {
-    raycast_draw(raycaster, rect, &RAYCAST_EMPTY);
+void raycast_erase(Raycaster* raycaster, const RaycastRect* rect) {
+    raycast_draw(raycaster, rect, &RAYCAST_EMPTY);
+}
+
+/**
+ * @brief Get the map edits made after a given revision.
+ *
+ * Each edit is the rectangle of cells one raycast_draw(), raycast_erase(), thin wall change
+ * or raycast_mark_cell() call changed, in cell coordinates and clipped to the map, oldest
+ * first.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param since Revision the caller is up to date with (a previous value of revision).
+ * @param edits Filled with up to RAYCAST_EDIT_JOURNAL edits.
+ * @return The number of edits, or -1 if some of them are no longer in the journal (or the map
+ *         was re-initialized) and the caller has to treat the whole map as changed.
+ */
+int raycast_get_edits(const Raycaster* raycaster, Uint64 since, RaycastRect* edits) {
+    if (since < raycaster->editBase || raycaster->revision - since > RAYCAST_EDIT_JOURNAL) {
+        return -1;
+    }
+
+    int count = 0;
+    for (Uint64 revision = since + 1; revision <= raycaster->revision; revision++) {
+        edits[count++] = raycaster->edits[revision % RAYCAST_EDIT_JOURNAL];
+    }
+    return count;
+}
+
+/**
+ * @brief Record a change of a map cell that did not go through raycast_draw().
+ *
+ * Used after writing the open field of a door, so caches that follow the edit journal
+ * (pathfinders, visibility sets, lightmaps) refresh the cell.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param x The x coordinate of the cell.
+ * @param y The y coordinate of the cell.
+ */
+void raycast_mark_cell(Raycaster* raycaster, int x, int y) {
+    if (!raycaster || x < 0 || x >= raycaster->width || y < 0 || y >= raycaster->height) {
+        return;
+    }
+    record_edit(raycaster, x, y, 1, 1);
+}
+
+/**
+ * @brief Get the raw value of a map cell.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param x The x coordinate of the cell.
+ * @param y The y coordinate of the cell.
+ * @return The cell type ID for compact maps, the stored RaycastColor otherwise, or
+ *         RAYCAST_EMPTY if the cell is outside the map.
+ */
+int raycast_get_cell(const Raycaster* raycaster, int x, int y) {
+    if (x < 0 || x >= raycaster->width || y < 0 || y >= raycaster->height) {
+        return RAYCAST_EMPTY;
+    }
+    return cell_raw(raycaster, y * raycaster->width + x);
+}
+
+/**
+ * @brief Initialize a Raycaster instance.
+ *
+ * This function allocates a new Raycaster instance and initializes it with the specified width and height.
+ *
+ * @param w The width of the Raycaster map.
+ * @param h The height of the Raycaster map.
+ * @return The newly allocated Raycaster instance, or NULL on failure.
+ */
+Raycaster* raycast_init(int w, int h) {
+    Raycaster* raycaster = (Raycaster*) calloc(1, sizeof(Raycaster));
+    if (!raycaster) {
+        return NULL;
+    }
+
+    int result = raycast_init_ptr(raycaster, w, h);
+
+    if (result) {
+        free(raycaster);
+        return NULL;
+    }
+
+    return raycaster;
+}
+
+/**
+ * @brief Initialize a Raycaster instance inside an arena.
+ *
+ * The Raycaster, its map and its texture and cell type arrays are all allocated from the
+ * arena, with room for textureCapacity textures reserved up front. Tearing down the level
+ * is a single raycast_arena_destroy() (or raycast_arena_reset() to load the next level into
+ * the same memory). Textures from raycast_texture_create_arena() pair naturally with this.
+ *
+ * @param arena The arena to allocate from.
+ * @param w The width of the Raycaster map.
+ * @param h The height of the Raycaster map.
+ * @param bits Bits per cell: 32 for a RaycastColor map, or 8 or 16 for a compact map.
+ * @param textureCapacity Number of textures to reserve room for.
+ * @return The newly allocated Raycaster instance (with every cell empty), or NULL if the
+ *         arguments are invalid or the arena is full.
+ */
+Raycaster* raycast_init_arena(RaycastArena* arena, int w, int h, int bits, int textureCapacity) {
+    if (!arena || (bits != 8 && bits != 16 && bits != 32) || w <= 0 || h <= 0 || w > INT_MAX / h) {
+        return NULL;
+    }
+
+    size_t     mark      = arena->used;
+    Raycaster* raycaster = (Raycaster*) raycast_arena_alloc(arena, sizeof(Raycaster));
+    if (!raycaster) {
+        return NULL;
+    }
+
+    raycaster->arena    = arena;
+    raycaster->width    = w;
+    raycaster->height   = h;
+    raycaster->cellBits = bits;
+
+    if (bits == 32) {
+        size_t size    = (size_t) w * h * sizeof(RaycastColor);
+        raycaster->map = (RaycastColor*) raycast_arena_alloc(arena, size);
+        if (!raycaster->map) {
+            arena->used = mark;
+            return NULL;
+        }
+        memset(raycaster->map, 0xFF, size); // RAYCAST_EMPTY
+    } else {
+        raycaster->cells = raycast_arena_alloc(arena, (size_t) w * h * (bits / 8));
+        raycaster->cellTypes
+            = (RaycastCellType*) raycast_arena_alloc(arena, sizeof(RaycastCellType));
+        if (!raycaster->cells || !raycaster->cellTypes) {
+            arena->used = mark;
+            return NULL;
+        }
+        raycaster->cellTypes[RAYCAST_CELL_EMPTY]
+            = (RaycastCellType){ .color = RAYCAST_EMPTY, .textureId = -1, .solid = 0 };
+        raycaster->cellTypeCount    = 1;
+        raycaster->cellTypeCapacity = 1;
+    }
+
+    if (textureCapacity > 0) {
+        raycaster->textures
+            = (RaycastTexture**) raycast_arena_alloc(arena,
+                                                     textureCapacity * sizeof(RaycastTexture*));
+        if (!raycaster->textures) {
+            arena->used = mark;
+            return NULL;
+        }
+        raycaster->textureCapacity = textureCapacity;
+    }
+
+    reset_edits(raycaster);
+    return raycaster;
+}
+
+/**
+ * @brief (Re-)Initialize an allocated raycaster instance.
+ *
+ * This function initializes or re-initializes a pre-allocated Raycaster instance with the specified width and height.
+ * If the instance already has an allocated map, it will be freed before allocating a new one.
+ *
+ * @param raycaster The Raycaster to initialize.
+ * @param w The width of the Raycaster map.
+ * @param h The height of the Raycaster map.
+ * @return 0 on success, 1 on memory allocation failure.
+ */
+int raycast_init_ptr(Raycaster* raycaster, int w, int h) {
+    free_map(raycaster);
+    raycaster->arena    = NULL;
+    raycaster->cellBits = 32;
+
+    raycaster->map      = (RaycastColor*) malloc(w * h * sizeof(RaycastColor));
+    if (!raycaster->map) {
+        return 1;
+    }
+
+    raycaster->width           = w;
+    raycaster->height          = h;
+    raycaster->textures        = NULL;
+    raycaster->textureCount    = 0;
+    raycaster->textureCapacity = 0;
+    raycaster->maxDistance     = 0.0f;
+    raycaster->fogColor        = 0;
+    reset_edits(raycaster);
+    return 0;
 }
 
 /**
- * @brief Initialize a Raycaster instance.
+ * @brief Initialize a Raycaster instance with a compact map.
  *
- * This function allocates a new Raycaster instance and initializes it with the specified width and height.
+ * A compact map stores an 8- or 16-bit cell type ID per cell instead of a full RaycastColor.
+ * All cells start out empty (RAYCAST_CELL_EMPTY); add types with raycast_add_cell_type().
  *
  * @param w The width of the Raycaster map.
  * @param h The height of the Raycaster map.
+ * @param bits Bits per cell, 8 or 16.
  * @return The newly allocated Raycaster instance, or NULL on failure.
  */
-Raycaster* raycast_init(int w, int h) {
+Raycaster* raycast_init_compact(int w, int h, int bits) {
     Raycaster* raycaster = (Raycaster*) calloc(1, sizeof(Raycaster));
     if (!raycaster) {
         return NULL;
     }
 
-    int result = raycast_init_ptr(raycaster, w, h);
-
-    if (result) {
+    if (raycast_init_compact_ptr(raycaster, w, h, bits)) {
         free(raycaster);
         return NULL;
     }
@@ -306,30 +2304,44 @@ Raycaster* raycast_init(int w, int h) {
 }
 
 /**
- * @brief (Re-)Initialize an allocated raycaster instance.
+ * @brief (Re-)Initialize an allocated raycaster instance with a compact map.
  *
- * This function initializes or re-initializes a pre-allocated Raycaster instance with the specified width and height.
- * If the instance already has an allocated map, it will be freed before allocating a new one.
+ * Any previously allocated map and cell type table are freed.
  *
  * @param raycaster The Raycaster to initialize.
  * @param w The width of the Raycaster map.
  * @param h The height of the Raycaster map.
- * @return 0 on success, 1 on memory allocation failure.
+ * @param bits Bits per cell, 8 or 16.
+ * @return 0 on success, 1 on invalid arguments or memory allocation failure.
  */
-int raycast_init_ptr(Raycaster* raycaster, int w, int h) {
-    if (raycaster->map) {
-        free(raycaster->map);
+int raycast_init_compact_ptr(Raycaster* raycaster, int w, int h, int bits) {
+    if (bits != 8 && bits != 16) {
+        return 1;
     }
 
-    raycaster->map = (RaycastColor*) malloc(w * h * sizeof(RaycastColor));
-    if (!raycaster->map) {
+    free_map(raycaster);
+    raycaster->arena     = NULL;
+
+    raycaster->cells     = calloc(w * h, bits / 8);
+    raycaster->cellTypes = (RaycastCellType*) malloc(sizeof(RaycastCellType));
+    if (!raycaster->cells || !raycaster->cellTypes) {
+        free_map(raycaster);
         return 1;
     }
 
-    raycaster->width        = w;
-    raycaster->height       = h;
-    raycaster->textures     = NULL;
-    raycaster->textureCount = 0;
+    raycaster->cellTypes[RAYCAST_CELL_EMPTY]
+        = (RaycastCellType){ .color = RAYCAST_EMPTY, .textureId = -1, .solid = 0 };
+    raycaster->cellTypeCount    = 1;
+    raycaster->cellTypeCapacity = 1;
+    raycaster->cellBits         = bits;
+    raycaster->width            = w;
+    raycaster->height           = h;
+    raycaster->textures         = NULL;
+    raycaster->textureCount     = 0;
+    raycaster->textureCapacity  = 0;
+    raycaster->maxDistance      = 0.0f;
+    raycaster->fogColor         = 0;
+    reset_edits(raycaster);
     return 0;
 }
 
@@ -373,6 +2385,177 @@ void raycast_move_camera_with_collision(Raycaster*       raycaster,
     }
 }
 
+/**
+ * @brief Vertex and index scratch of raycast_render(), owned by the SDL renderer it draws to.
+ */
+typedef struct {
+    SDL_Vertex* vertices;
+    int*        indices;
+    int         quads;
+} RenderGeometry;
+
+#define RENDER_GEOMETRY_PROPERTY "raycast.geometry"
+
+/**
+ * @brief Free the geometry scratch of a renderer (SDL property cleanup callback).
+ *
+ * @param userdata Unused.
+ * @param value The RenderGeometry.
+ */
+static void geometry_free(void* userdata, void* value) {
+    RenderGeometry* geometry = (RenderGeometry*) value;
+    free(geometry->vertices);
+    free(geometry->indices);
+    free(geometry);
+}
+
+/**
+ * @brief Get the geometry scratch of a renderer with room for at least a number of quads.
+ *
+ * The scratch is a property of the renderer, so the Raycaster is not written by rendering
+ * and every renderer draws from its own batch. It only grows, so steady-state frames do not
+ * allocate. The index pattern of every quad is filled in once, when the scratch is created.
+ *
+ * @param renderer The SDL_Renderer.
+ * @param quads Number of quads needed.
+ * @return The scratch, or NULL on allocation failure.
+ */
+static RenderGeometry* renderer_geometry(SDL_Renderer* renderer, int quads) {
+    SDL_PropertiesID props = SDL_GetRendererProperties(renderer);
+    if (!props) {
+        return NULL;
+    }
+
+    RenderGeometry* geometry
+        = (RenderGeometry*) SDL_GetPointerProperty(props, RENDER_GEOMETRY_PROPERTY, NULL);
+    if (geometry && geometry->quads >= quads) {
+        return geometry;
+    }
+
+    geometry = (RenderGeometry*) calloc(1, sizeof(RenderGeometry));
+    if (!geometry) {
+        return NULL;
+    }
+    geometry->vertices = (SDL_Vertex*) malloc((size_t) quads * 4 * sizeof(SDL_Vertex));
+    geometry->indices  = (int*) malloc((size_t) quads * 6 * sizeof(int));
+    geometry->quads    = quads;
+    if (!geometry->vertices || !geometry->indices) {
+        geometry_free(NULL, geometry);
+        return NULL;
+    }
+    for (int quad = 0; quad < quads; quad++) {
+        int* index = geometry->indices + quad * 6;
+        int  first = quad * 4;
+        index[0]   = first;
+        index[1]   = first + 1;
+        index[2]   = first + 2;
+        index[3]   = first;
+        index[4]   = first + 2;
+        index[5]   = first + 3;
+    }
+
+    // Replacing the property frees the smaller scratch; on failure SDL frees the new one
+    if (!SDL_SetPointerPropertyWithCleanup(props,
+                                           RENDER_GEOMETRY_PROPERTY,
+                                           geometry,
+                                           geometry_free,
+                                           NULL)) {
+        return NULL;
+    }
+    return geometry;
+}
+
+/**
+ * @brief Render the Raycaster map to the display and fill per-column hit data.
+ *
+ * @param raycaster The Raycaster instance to render.
+ * @param camera The camera settings for rendering.
+ * @param renderer The SDL_Renderer to use for rendering.
+ * @param w The width of the rendering area.
+ * @param h The height of the rendering area.
+ * @param background The background color to use for empty spaces.
+ * @param gbuffer Per-column hit data to fill (w entries), or NULL.
+ */
+void raycast_render_gbuffer(Raycaster*           raycaster,
+                            const RaycastCamera* camera,
+                            SDL_Renderer*        renderer,
+                            int                  w,
+                            int                  h,
+                            const RaycastColor*  background,
+                            RaycastGBuffer*      gbuffer) {
+    float           direction = atan2f(camera->dirY, camera->dirX) * (180.0f / M_PI);
+    RenderGeometry* geometry  = renderer_geometry(renderer, w);
+    if (!geometry) {
+        return;
+    }
+
+    // Sky and floor share the background color, so one rect covers both
+    SDL_FRect screen = { 0.0f, 0.0f, (float) w, (float) h };
+    raycast_set_draw_color(renderer, background);
+    SDL_RenderFillRect(renderer, &screen);
+
+    // Collect wall slices as quads; neighbouring columns of equal extent and color are merged
+    SDL_Vertex*  vertices  = geometry->vertices;
+    int          quads     = 0;
+    int          lastTop   = 0;
+    int          lastBot   = 0;
+    RaycastColor lastColor = RAYCAST_EMPTY;
+
+    for (int x = 0; x < w; x++) {
+        float      angle = direction - (camera->fov / 2.0f) + (camera->fov * x) / w;
+        RaycastHit hit;
+        cast_march(raycaster, camera->posX, camera->posY, angle, &hit);
+        gbuffer_store(gbuffer, x, &hit);
+
+        float        distance = hit.distance;
+        RaycastColor hitColor = hit.textureId;
+        if (hitColor == RAYCAST_EMPTY) {
+            lastColor = RAYCAST_EMPTY;
+            continue;
+        }
+        hitColor = blend_color(hitColor, raycaster->fogColor, fog_amount(raycaster, distance));
+
+        // Simple wall height calculation (inverse proportional to distance)
+        int wallHeight = (distance > 0.0f) ? (int) (h / (distance + 0.0001f)) : 0;
+        int wallTop    = (h - wallHeight) / 2;
+        int wallBottom = wallTop + wallHeight;
+        if (wallHeight <= 0) {
+            lastColor = RAYCAST_EMPTY;
+            continue;
+        }
+
+        if (quads > 0 && hitColor == lastColor && wallTop == lastTop && wallBottom == lastBot) {
+            vertices[(quads - 1) * 4 + 1].position.x = (float) (x + 1);
+            vertices[(quads - 1) * 4 + 2].position.x = (float) (x + 1);
+            continue;
+        }
+
+        uint32_t    c      = (uint32_t) hitColor;
+        SDL_FColor  color  = { ((c >> 16) & 0xFF) / 255.0f,
+                               ((c >> 8) & 0xFF) / 255.0f,
+                               (c & 0xFF) / 255.0f,
+                               ((c >> 24) & 0xFF) / 255.0f };
+        float       left   = (float) x;
+        float       right  = (float) (x + 1);
+        float       top    = (float) wallTop;
+        float       bottom = (float) wallBottom;
+        SDL_Vertex* quad   = vertices + quads * 4;
+        quad[0]            = (SDL_Vertex){ { left, top }, color, { 0.0f, 0.0f } };
+        quad[1]            = (SDL_Vertex){ { right, top }, color, { 0.0f, 0.0f } };
+        quad[2]            = (SDL_Vertex){ { right, bottom }, color, { 0.0f, 0.0f } };
+        quad[3]            = (SDL_Vertex){ { left, bottom }, color, { 0.0f, 0.0f } };
+        quads++;
+
+        lastColor = hitColor;
+        lastTop   = wallTop;
+        lastBot   = wallBottom;
+    }
+
+    if (quads > 0) {
+        SDL_RenderGeometry(renderer, NULL, vertices, quads * 4, geometry->indices, quads * 6);
+    }
+}
+
 /**
  * @brief Render the Raycaster map to the display.
  *
@@ -389,28 +2572,76 @@ void raycast_render(Raycaster*           raycaster,
                     int                  w,
                     int                  h,
                     const RaycastColor*  background) {
+    raycast_render_gbuffer(raycaster, camera, renderer, w, h, background, NULL);
+}
+
+/**
+ * @brief Render the Raycaster map with textures to the display and fill per-column hit data.
+ *
+ * @param raycaster The Raycaster instance to render.
+ * @param camera The camera settings for rendering.
+ * @param renderer The SDL_Renderer to use for rendering.
+ * @param w The width of the rendering area.
+ * @param h The height of the rendering area.
+ * @param background The background color to use for empty spaces.
+ * @param gbuffer Per-column hit data to fill (w entries), or NULL.
+ */
+void raycast_render_textured_gbuffer(Raycaster*           raycaster,
+                                     const RaycastCamera* camera,
+                                     SDL_Renderer*        renderer,
+                                     int                  w,
+                                     int                  h,
+                                     const RaycastColor*  background,
+                                     RaycastGBuffer*      gbuffer) {
     float direction = atan2f(camera->dirY, camera->dirX) * (180.0f / M_PI);
 
-    // Render each vertical slice (column) of the screen
     for (int x = 0; x < w; x++) {
-        float        angle    = direction - (camera->fov / 2.0f) + (camera->fov * x) / w;
-        RaycastColor hitColor = RAYCAST_EMPTY;
-        float distance = raycast_cast(raycaster, camera->posX, camera->posY, angle, &hitColor);
+        float      angle = direction - (camera->fov / 2.0f) + (camera->fov * x) / w;
+        RaycastHit hit;
+        raycast_cast_textured(raycaster, camera->posX, camera->posY, angle, &hit);
+        gbuffer_store(gbuffer, x, &hit);
 
-        // Simple wall height calculation (inverse proportional to distance)
-        int wallHeight = (distance > 0.0f) ? (int) (h / (distance + 0.0001f)) : 0;
+        int wallHeight = (hit.distance > 0.0f) ? (int) (h / (hit.distance + 0.0001f)) : 0;
         int wallTop    = (h - wallHeight) / 2;
         int wallBottom = wallTop + wallHeight;
 
-        // Draw background above wall
         raycast_set_draw_color(renderer, background);
         SDL_RenderLine(renderer, x, 0, x, wallTop);
 
-        // Draw wall slice
-        raycast_set_draw_color(renderer, (hitColor == RAYCAST_EMPTY) ? background : &hitColor);
-        SDL_RenderLine(renderer, x, wallTop, x, wallBottom);
+        if (hit.textureId >= 0 && hit.textureId < raycaster->textureCount) {
+            int          drawTop    = (wallTop < 0) ? 0 : wallTop;
+            int          drawBottom = (wallBottom > h) ? h : wallBottom;
+
+            WallSpans    spans;
+            int          top, bottom;
+            RaycastColor color;
+            wall_spans_init(&spans,
+                            raycaster,
+                            &hit,
+                            wallTop,
+                            wallHeight,
+                            drawTop,
+                            drawBottom,
+                            hit_light(raycaster, &hit, angle));
+            while (wall_span_next(&spans, &top, &bottom, &color)) {
+                raycast_set_draw_color(renderer, &color);
+                SDL_RenderLine(renderer, x, top, x, bottom - 1);
+            }
+        } else {
+            RaycastColor fallbackColor = (hit.textureId == -1) ? *background : hit.textureId;
+            if (hit.textureId != -1) {
+                const uint8_t* light = hit_light(raycaster, &hit, angle);
+                if (light) {
+                    fallbackColor = light_color(fallbackColor, light);
+                }
+                fallbackColor = blend_color(fallbackColor,
+                                            raycaster->fogColor,
+                                            fog_amount(raycaster, hit.distance));
+            }
+            raycast_set_draw_color(renderer, &fallbackColor);
+            SDL_RenderLine(renderer, x, wallTop, x, wallBottom);
+        }
 
-        // Draw background below wall
         raycast_set_draw_color(renderer, background);
         SDL_RenderLine(renderer, x, wallBottom, x, h);
     }
@@ -432,63 +2663,500 @@ void raycast_render_textured(Raycaster*           raycaster,
                              int                  w,
                              int                  h,
                              const RaycastColor*  background) {
-    float direction = atan2f(camera->dirY, camera->dirX) * (180.0f / M_PI);
+    raycast_render_textured_gbuffer(raycaster, camera, renderer, w, h, background, NULL);
+}
 
-    for (int x = 0; x < w; x++) {
-        float      angle = direction - (camera->fov / 2.0f) + (camera->fov * x) / w;
-        RaycastHit hit;
-        raycast_cast_textured(raycaster, camera->posX, camera->posY, angle, &hit);
+/**
+ * @brief Blend a translucent wall layer over one framebuffer column.
+ *
+ * @param raycaster The Raycaster instance.
+ * @param pixels Row-major framebuffer in the pixel format of the Raycaster.
+ * @param w The width of the framebuffer.
+ * @param h The height of the framebuffer.
+ * @param x The column.
+ * @param hit The translucent hit.
+ */
+static void composite_layer(
+    const Raycaster* raycaster, void* pixels, int w, int h, int x, const RaycastHit* hit) {
+    int wallHeight = (int) (h / (hit->distance + 0.0001f));
+    int wallTop    = (h - wallHeight) / 2;
+    int wallBottom = wallTop + wallHeight;
+    int drawTop    = (wallTop < 0) ? 0 : wallTop;
+    int drawBottom = (wallBottom > h) ? h : wallBottom;
+
+    if (hit->textureId >= 0 && hit->textureId < raycaster->textureCount) {
+        WallSpans    spans;
+        int          top, bottom;
+        RaycastColor color;
+        wall_spans_init(&spans, raycaster, hit, wallTop, wallHeight, drawTop, drawBottom, NULL);
+        while (wall_span_next(&spans, &top, &bottom, &color)) {
+            blend_pixels(pixels, raycaster->pixelFormat, w, x, top, bottom, color);
+        }
+    } else {
+        RaycastColor color = blend_color(hit->textureId,
+                                         raycaster->fogColor,
+                                         fog_amount(raycaster, hit->distance));
+        blend_pixels(pixels, raycaster->pixelFormat, w, x, drawTop, drawBottom, color);
+    }
+}
+
+/**
+ * @brief Batched render job shared by all tasks of raycast_render_batch().
+ */
+typedef struct {
+    Raycaster*           raycaster;
+    const RaycastCamera* cameras;
+    uint8_t*             frames;
+    float*               depth;
+    int                  w;
+    int                  h;
+    int                  tilesPerCamera;
+    const RaycastColor*  background;
+    RaycastGBuffer*      gbuffer;
+} RenderBatchJob;
+
+/**
+ * @brief Render a range of columns of one camera into a framebuffer.
+ *
+ * Produces the same image as raycast_render_textured() for the same columns. Nothing is
+ * written if the Raycaster's pixel format is not a RaycastPixelFormat value.
+ *
+ * @param raycaster The Raycaster instance to render.
+ * @param camera The camera settings for rendering.
+ * @param pixels Row-major framebuffer of w * h pixels in the pixel format of the Raycaster.
+ * @param depth Row-major per-pixel wall distance of w * h floats (0 where no wall), or NULL.
+ * @param w The width of the framebuffer.
+ * @param h The height of the framebuffer.
+ * @param x0 First column to render.
+ * @param x1 One past the last column to render.
+ * @param background The background color to use for empty spaces.
+ * @param gbuffer Per-column hit data to fill (w entries), or NULL.
+ * @param gbufferOffset Index of column 0 in the G-buffer arrays.
+ */
+static void render_buffer_columns(Raycaster*           raycaster,
+                                  const RaycastCamera* camera,
+                                  void*                pixels,
+                                  float*               depth,
+                                  int                  w,
+                                  int                  h,
+                                  int                  x0,
+                                  int                  x1,
+                                  const RaycastColor*  background,
+                                  RaycastGBuffer*      gbuffer,
+                                  size_t               gbufferOffset) {
+    float              direction = atan2f(camera->dirY, camera->dirX) * (180.0f / M_PI);
+    RaycastPixelFormat format    = raycaster->pixelFormat;
+    bool               layered   = has_translucency(raycaster);
+    if (!pixel_format_valid(format)) {
+        return;
+    }
+
+    for (int x = x0; x < x1; x++) {
+        float          angle = direction - (camera->fov / 2.0f) + (camera->fov * x) / w;
+        RaycastHitList layers;
+        RaycastHit     hit   = { 0.0f, 0.0f, 0, -1, -1 };
+        int            layer = 0;
+
+        // The opaque wall is drawn as a single hit; translucent layers go on top of it. Maps
+        // without translucent walls skip the layer walk entirely.
+        if (layered) {
+            raycast_cast_layers(raycaster, camera->posX, camera->posY, angle, &layers);
+            layer = layers.count;
+            if (layer > 0 && !hit_translucent(raycaster, &layers.hits[layer - 1])) {
+                hit = layers.hits[--layer];
+            }
+        } else {
+            raycast_cast_textured(raycaster, camera->posX, camera->posY, angle, &hit);
+        }
+        gbuffer_store(gbuffer, gbufferOffset + x, &hit);
 
         int wallHeight = (hit.distance > 0.0f) ? (int) (h / (hit.distance + 0.0001f)) : 0;
         int wallTop    = (h - wallHeight) / 2;
         int wallBottom = wallTop + wallHeight;
+        int drawTop    = (wallTop < 0) ? 0 : wallTop;
+        int drawBottom = (wallBottom > h) ? h : wallBottom;
 
-        raycast_set_draw_color(renderer, background);
-        SDL_RenderLine(renderer, x, 0, x, wallTop);
+        fill_pixels(pixels, format, w, x, 0, drawTop, *background);
 
         if (hit.textureId >= 0 && hit.textureId < raycaster->textureCount) {
-            RaycastTexture* texture = raycaster->textures[hit.textureId];
-            int             texX    = (int) (hit.wallX * texture->width);
-            if (texX < 0)
-                texX = 0;
-            if (texX >= texture->width)
-                texX = texture->width - 1;
-
-            for (int y = wallTop; y < wallBottom; y++) {
-                if (y < 0 || y >= h)
-                    continue;
-
-                float texY      = (float) (y - wallTop) / (float) wallHeight;
-                int   texYCoord = (int) (texY * texture->height);
-                if (texYCoord < 0)
-                    texYCoord = 0;
-                if (texYCoord >= texture->height)
-                    texYCoord = texture->height - 1;
-
-                RaycastColor color = texture->pixels[texYCoord * texture->width + texX];
-
-                if (hit.side == 1) {
-                    int r = ((color >> 16) & 0xFF) / 2;
-                    int g = ((color >> 8) & 0xFF) / 2;
-                    int b = (color & 0xFF) / 2;
-                    int a = (color >> 24) & 0xFF;
-                    color = (a << 24) | (r << 16) | (g << 8) | b;
+            WallSpans spans;
+            wall_spans_init(&spans,
+                            raycaster,
+                            &hit,
+                            wallTop,
+                            wallHeight,
+                            drawTop,
+                            drawBottom,
+                            hit_light(raycaster, &hit, angle));
+            column_kernel(&spans, format)(pixels, w, x, &spans);
+        } else {
+            RaycastColor fallbackColor = (hit.textureId == -1) ? *background : hit.textureId;
+            if (hit.textureId != -1) {
+                const uint8_t* light = hit_light(raycaster, &hit, angle);
+                if (light) {
+                    fallbackColor = light_color(fallbackColor, light);
                 }
+                fallbackColor = blend_color(fallbackColor,
+                                            raycaster->fogColor,
+                                            fog_amount(raycaster, hit.distance));
+            }
+            fill_pixels(pixels, format, w, x, drawTop, drawBottom, fallbackColor);
+        }
 
-                raycast_set_draw_color(renderer, &color);
-                SDL_RenderPoint(renderer, x, y);
+        fill_pixels(pixels,
+                    format,
+                    w,
+                    x,
+                    (drawBottom > drawTop) ? drawBottom : drawTop,
+                    h,
+                    *background);
+
+        while (layer-- > 0) {
+            composite_layer(raycaster, pixels, w, h, x, &layers.hits[layer]);
+        }
+
+        if (depth) {
+            for (int y = 0; y < h; y++) {
+                depth[y * w + x] = (y >= drawTop && y < drawBottom) ? hit.distance : 0.0f;
             }
-        } else {
-            RaycastColor fallbackColor = (hit.textureId == -1) ? *background : hit.textureId;
-            raycast_set_draw_color(renderer, &fallbackColor);
-            SDL_RenderLine(renderer, x, wallTop, x, wallBottom);
         }
+    }
+}
 
-        raycast_set_draw_color(renderer, background);
-        SDL_RenderLine(renderer, x, wallBottom, x, h);
+/**
+ * @brief Render one column tile of one camera of a batched render job.
+ *
+ * @param data The RenderBatchJob.
+ * @param index Task index (camera * tilesPerCamera + tile).
+ */
+static void render_batch_task(void* data, int index) {
+    RenderBatchJob* job    = (RenderBatchJob*) data;
+    int             camera = index / job->tilesPerCamera;
+    int             tile   = index % job->tilesPerCamera;
+    int             x0     = tile * RAYCAST_TILE_COLUMNS;
+    int             x1     = x0 + RAYCAST_TILE_COLUMNS;
+    size_t          offset = (size_t) camera * job->w * job->h;
+    size_t          bytes  = offset * raycast_pixel_size(job->raycaster->pixelFormat);
+
+    if (x1 > job->w) {
+        x1 = job->w;
+    }
+
+    render_buffer_columns(job->raycaster,
+                          &job->cameras[camera],
+                          job->frames + bytes,
+                          job->depth ? job->depth + offset : NULL,
+                          job->w,
+                          job->h,
+                          x0,
+                          x1,
+                          job->background,
+                          job->gbuffer,
+                          (size_t) camera * job->w);
+}
+
+/**
+ * @brief Render the Raycaster map with textures into a framebuffer and fill per-column hit data.
+ *
+ * This is the headless counterpart of raycast_render_textured(): instead of issuing draw
+ * calls it writes pixels straight into memory, in the pixel format of the Raycaster.
+ * Translucent walls are composited back to front over the opaque wall behind them (see
+ * raycast_cast_layers).
+ *
+ * @param raycaster The Raycaster instance to render.
+ * @param camera The camera settings for rendering.
+ * @param pixels Row-major framebuffer of w * h pixels in the pixel format of the Raycaster.
+ * @param depth Row-major per-pixel distance of the opaque wall of w * h floats (0 where no
+ *              wall), or NULL.
+ * @param w The width of the framebuffer.
+ * @param h The height of the framebuffer.
+ * @param background The background color to use for empty spaces.
+ * @param gbuffer Per-column hit data to fill (w entries), or NULL.
+ */
+void raycast_render_buffer_gbuffer(Raycaster*           raycaster,
+                                   const RaycastCamera* camera,
+                                   void*                pixels,
+                                   float*               depth,
+                                   int                  w,
+                                   int                  h,
+                                   const RaycastColor*  background,
+                                   RaycastGBuffer*      gbuffer) {
+    render_buffer_columns(raycaster, camera, pixels, depth, w, h, 0, w, background, gbuffer, 0);
+}
+
+/**
+ * @brief Render the Raycaster map with textures into a framebuffer.
+ *
+ * This is the headless counterpart of raycast_render_textured(): instead of issuing draw
+ * calls it writes pixels straight into memory, in the pixel format of the Raycaster.
+ * Translucent walls are composited back to front over the opaque wall behind them (see
+ * raycast_cast_layers).
+ *
+ * @param raycaster The Raycaster instance to render.
+ * @param camera The camera settings for rendering.
+ * @param pixels Row-major framebuffer of w * h pixels in the pixel format of the Raycaster.
+ * @param depth Row-major per-pixel distance of the opaque wall of w * h floats (0 where no
+ *              wall), or NULL.
+ * @param w The width of the framebuffer.
+ * @param h The height of the framebuffer.
+ * @param background The background color to use for empty spaces.
+ */
+void raycast_render_buffer(Raycaster*           raycaster,
+                           const RaycastCamera* camera,
+                           void*                pixels,
+                           float*               depth,
+                           int                  w,
+                           int                  h,
+                           const RaycastColor*  background) {
+    raycast_render_buffer_gbuffer(raycaster, camera, pixels, depth, w, h, background, NULL);
+}
+
+/**
+ * @brief Render many views into one frame buffer and fill per-column hit data.
+ *
+ * Views are written as a [count][h][w] array of pixels in the pixel format of the Raycaster
+ * (and optionally a [count][h][w] array of depths). The work is split into tiles of
+ * RAYCAST_TILE_COLUMNS columns per camera, which are distributed over the threads of the
+ * pool, so both many small views and a few large views keep every core busy.
+ *
+ * @param raycaster The Raycaster instance to render.
+ * @param cameras Array of count cameras.
+ * @param count Number of cameras.
+ * @param pool The thread pool to render on, or NULL to render on the calling thread.
+ * @param frames Output buffer of count * w * h pixels.
+ * @param depth Output buffer of count * w * h floats, or NULL.
+ * @param w The width of each view.
+ * @param h The height of each view.
+ * @param background The background color to use for empty spaces.
+ * @param gbuffer Per-column hit data to fill (count * w entries, camera-major), or NULL.
+ */
+void raycast_render_batch_gbuffer(Raycaster*           raycaster,
+                                  const RaycastCamera* cameras,
+                                  int                  count,
+                                  RaycastThreadPool*   pool,
+                                  void*                frames,
+                                  float*               depth,
+                                  int                  w,
+                                  int                  h,
+                                  const RaycastColor*  background,
+                                  RaycastGBuffer*      gbuffer) {
+    if (count <= 0 || w <= 0 || h <= 0) {
+        return;
+    }
+
+    RenderBatchJob job = { .raycaster      = raycaster,
+                           .cameras        = cameras,
+                           .frames         = (uint8_t*) frames,
+                           .depth          = depth,
+                           .w              = w,
+                           .h              = h,
+                           .tilesPerCamera = (w + RAYCAST_TILE_COLUMNS - 1) / RAYCAST_TILE_COLUMNS,
+                           .background     = background,
+                           .gbuffer        = gbuffer };
+
+    raycast_thread_pool_run(pool, render_batch_task, &job, count * job.tilesPerCamera);
+}
+
+/**
+ * @brief Render many views of the same Raycaster into one contiguous frame buffer.
+ *
+ * Views are written as a [count][h][w] array of pixels in the pixel format of the Raycaster
+ * (and optionally a [count][h][w] array of depths). The work is split into tiles of
+ * RAYCAST_TILE_COLUMNS columns per camera, which are distributed over the threads of the
+ * pool, so both many small views and a few large views keep every core busy.
+ *
+ * @param raycaster The Raycaster instance to render.
+ * @param cameras Array of count cameras.
+ * @param count Number of cameras.
+ * @param pool The thread pool to render on, or NULL to render on the calling thread.
+ * @param frames Output buffer of count * w * h pixels.
+ * @param depth Output buffer of count * w * h floats, or NULL.
+ * @param w The width of each view.
+ * @param h The height of each view.
+ * @param background The background color to use for empty spaces.
+ */
+void raycast_render_batch(Raycaster*           raycaster,
+                          const RaycastCamera* cameras,
+                          int                  count,
+                          RaycastThreadPool*   pool,
+                          void*                frames,
+                          float*               depth,
+                          int                  w,
+                          int                  h,
+                          const RaycastColor*  background) {
+    raycast_render_batch_gbuffer(raycaster,
+                                 cameras,
+                                 count,
+                                 pool,
+                                 frames,
+                                 depth,
+                                 w,
+                                 h,
+                                 background,
+                                 NULL);
+}
+
+/**
+ * @brief Terrain render job shared by all tasks of raycast_render_terrain().
+ */
+typedef struct {
+    const Raycaster*      raycaster;
+    const RaycastTerrain* terrain;
+    const RaycastCamera*  camera;
+    void*                 pixels;
+    int                   w;
+    int                   h;
+    const RaycastColor*   background;
+} TerrainJob;
+
+/**
+ * @brief Render a range of terrain columns front to back against a per-column y-buffer.
+ *
+ * @param job The terrain render job.
+ * @param x0 First column to render.
+ * @param x1 One past the last column to render.
+ */
+static void render_terrain_columns(const TerrainJob* job, int x0, int x1) {
+    const Raycaster*      raycaster = job->raycaster;
+    const RaycastTerrain* terrain   = job->terrain;
+    const RaycastCamera*  camera    = job->camera;
+    RaycastPixelFormat    format    = raycaster->pixelFormat;
+    int                   w         = job->w;
+    int                   h         = job->h;
+    float                 direction = atan2f(camera->dirY, camera->dirX) * (180.0f / M_PI);
+    float                 horizon   = h / 2.0f + terrain->pitch;
+
+    for (int x = x0; x < x1; x++) {
+        float angle   = direction - (camera->fov / 2.0f) + (camera->fov * x) / w;
+        float stepX   = cosf(angle * (M_PI / 180.0f));
+        float stepY   = sinf(angle * (M_PI / 180.0f));
+        float perp    = cosf((angle - direction) * (M_PI / 180.0f));
+        int   ybuffer = h; // Rows below are already covered by nearer terrain
+        float z       = terrain->step;
+
+        while (z <= terrain->distance && ybuffer > 0) {
+            int cellX = (int) floorf(camera->posX + stepX * z);
+            int cellY = (int) floorf(camera->posY + stepY * z);
+            if (cellX >= 0 && cellX < raycaster->width && cellY >= 0 && cellY < raycaster->height) {
+                int          index = cellY * raycaster->width + cellX;
+                RaycastColor color = cell_color(raycaster, index);
+                float        rise  = terrain->eye - terrain->heights[index] * terrain->scale;
+                int          top   = (int) floorf(horizon + rise * h / (z * perp));
+                if (color != RAYCAST_EMPTY && top < ybuffer) {
+                    top   = SDL_max(top, 0);
+                    color = blend_color(color, raycaster->fogColor, fog_amount(raycaster, z));
+                    fill_pixels(job->pixels, format, w, x, top, ybuffer, color);
+                    ybuffer = top;
+                }
+            }
+            z += terrain->step + z * terrain->lod;
+        }
+
+        fill_pixels(job->pixels, format, w, x, 0, ybuffer, *job->background);
+    }
+}
+
+/**
+ * @brief Render one column tile of a terrain render job.
+ *
+ * @param data The TerrainJob.
+ * @param index Index of the tile.
+ */
+static void render_terrain_task(void* data, int index) {
+    TerrainJob* job = (TerrainJob*) data;
+    int         x0  = index * RAYCAST_TILE_COLUMNS;
+    render_terrain_columns(job, x0, SDL_min(x0 + RAYCAST_TILE_COLUMNS, job->w));
+}
+
+/**
+ * @brief Render the map as a "voxel space" height field into a framebuffer.
+ *
+ * Every cell is a column of terrain as high as its entry in terrain->heights and colored
+ * like the cell (empty cells are holes). Each screen column is marched front to back from
+ * the camera, drawing only the rows not yet covered by nearer terrain; a column stops as
+ * soon as it is full. The distance between samples grows with the distance (terrain->lod),
+ * so the cost depends on the size of the view and the draw distance, not on the size of
+ * the map. Fog and the pixel format are those of the Raycaster, as for
+ * raycast_render_buffer().
+ *
+ * @param raycaster The Raycaster whose map colors the terrain.
+ * @param terrain The height field and its view settings.
+ * @param camera The camera settings for rendering.
+ * @param pool Thread pool to spread the columns over, or NULL to render on the calling thread.
+ * @param pixels Row-major framebuffer of w * h pixels in the pixel format of the Raycaster.
+ * @param w The width of the framebuffer.
+ * @param h The height of the framebuffer.
+ * @param background The sky color, drawn above the terrain.
+ */
+void raycast_render_terrain(Raycaster*            raycaster,
+                            const RaycastTerrain* terrain,
+                            const RaycastCamera*  camera,
+                            RaycastThreadPool*    pool,
+                            void*                 pixels,
+                            int                   w,
+                            int                   h,
+                            const RaycastColor*   background) {
+    if (!raycaster || !terrain || !terrain->heights || terrain->step <= 0.0f || w <= 0 || h <= 0) {
+        return;
+    }
+
+    TerrainJob job = { .raycaster  = raycaster,
+                       .terrain    = terrain,
+                       .camera     = camera,
+                       .pixels     = pixels,
+                       .w          = w,
+                       .h          = h,
+                       .background = background };
+
+    raycast_thread_pool_run(pool,
+                            render_terrain_task,
+                            &job,
+                            (w + RAYCAST_TILE_COLUMNS - 1) / RAYCAST_TILE_COLUMNS);
+}
+
+/**
+ * @brief Get the size of one pixel of an output pixel format.
+ *
+ * @param format The pixel format.
+ * @return The size of a pixel in bytes.
+ */
+int raycast_pixel_size(RaycastPixelFormat format) {
+    return (format == RAYCAST_PIXEL_RGB565) ? 2 : 4;
+}
+
+/**
+ * @brief Get the SDL pixel format matching an output pixel format.
+ *
+ * Use it to create a texture or surface that framebuffers rendered in the format can be
+ * uploaded to without conversion.
+ *
+ * @param format The pixel format.
+ * @return The matching SDL pixel format.
+ */
+SDL_PixelFormat raycast_pixel_format_sdl(RaycastPixelFormat format) {
+    switch (format) {
+    case RAYCAST_PIXEL_XRGB8888:
+        return SDL_PIXELFORMAT_XRGB8888;
+    case RAYCAST_PIXEL_ABGR8888:
+        return SDL_PIXELFORMAT_ABGR8888;
+    case RAYCAST_PIXEL_RGB565:
+        return SDL_PIXELFORMAT_RGB565;
+    default:
+        return SDL_PIXELFORMAT_ARGB8888;
     }
 }
 
+/**
+ * @brief Convert an ARGB color to an output pixel format.
+ *
+ * @param color The ARGB color.
+ * @param format The pixel format.
+ * @return The pixel as written to a framebuffer of the format (in the low 16 bits for RGB565).
+ */
+Uint32 raycast_convert_color(RaycastColor color, RaycastPixelFormat format) {
+    return convert_color(color, format);
+}
+
 /**
  * @brief Render the Raycaster map in 2D mode to the display.
  *
@@ -515,7 +3183,7 @@ void raycast_render_2d(Raycaster*           raycaster,
     if (raycaster->textured) {
         for (int y = 0; y < raycaster->height; y++) {
             for (int x = 0; x < raycaster->width; x++) {
-                int textureID = raycaster->map[y * raycaster->width + x];
+                int textureID = cell_value(raycaster, y * raycaster->width + x);
                 if (textureID == -1) {
                     raycast_set_draw_color(renderer, background);
                     SDL_FRect rect = { ((float) x) * scale, ((float) y) * scale, scale, scale };
@@ -530,7 +3198,7 @@ void raycast_render_2d(Raycaster*           raycaster,
     } else {
         for (int y = 0; y < raycaster->height; y++) {
             for (int x = 0; x < raycaster->width; x++) {
-                RaycastColor color = raycaster->map[y * raycaster->width + x];
+                RaycastColor color = cell_color(raycaster, y * raycaster->width + x);
                 raycast_set_draw_color(renderer, (color == RAYCAST_EMPTY) ? background : &color);
                 SDL_RenderPoint(renderer, ((float) x) * scale, ((float) y) * scale);
             }
@@ -546,7 +3214,8 @@ void raycast_render_2d(Raycaster*           raycaster,
     for (float angle = startX; angle <= endX; angle += ((float) camera->fov) / ((float) w)) {
         float distance = raycast_cast(raycaster, camera->posX, camera->posY, angle, &hit);
         if (distance == 0) {
-            distance = raycaster->width + raycaster->height;
+            distance = (raycaster->maxDistance > 0.0f) ? raycaster->maxDistance
+                                                       : raycaster->width + raycaster->height;
         }
         SDL_RenderLine(renderer,
                        camera->posX * scale,
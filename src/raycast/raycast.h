@@ -10,20 +10,73 @@
 
 typedef int32_t           RaycastColor; // ARGB format: 0xAARRGGBB
 static const RaycastColor RAYCAST_EMPTY = -1;
+#define RAYCAST_TILE_COLUMNS    32 // Columns per work item in batched rendering
+#define RAYCAST_CELL_EMPTY      0 // Empty cell ID in compact maps
+#define RAYCAST_ARENA_ALIGNMENT 64 // Alignment of every arena allocation
+#define RAYCAST_EDIT_JOURNAL    64 // Map edits remembered for incremental consumers
+#define RAYCAST_SNAPSHOT_ROWS   16 // Map rows per copy-on-write snapshot chunk
+#define RAYCAST_PVS_BLOCK       8 // Cells per side of a potentially-visible-set block
+#define RAYCAST_MAX_HITS        4 // Wall layers collected per ray by raycast_cast_layers
 typedef enum { RAYCAST_FORWARD, RAYCAST_BACKWARD, RAYCAST_LEFT, RAYCAST_RIGHT } RaycastDirection;
+typedef enum { RAYCAST_THIN_VERTICAL, RAYCAST_THIN_HORIZONTAL } RaycastThinOrientation;
+typedef enum {
+    RAYCAST_PIXEL_ARGB8888, // 0xAARRGGBB, the RaycastColor layout
+    RAYCAST_PIXEL_XRGB8888, // 0xFFRRGGBB
+    RAYCAST_PIXEL_ABGR8888, // 0xAABBGGRR
+    RAYCAST_PIXEL_RGB565 // 16-bit 0bRRRRRGGGGGGBBBBB
+} RaycastPixelFormat;
+typedef enum { RAYCAST_STREAM_RGBA, RAYCAST_STREAM_Y4M } RaycastStreamFormat;
+typedef enum {
+    RAYCAST_FACE_WEST, // Face toward -x
+    RAYCAST_FACE_EAST, // Face toward +x
+    RAYCAST_FACE_NORTH, // Face toward -y
+    RAYCAST_FACE_SOUTH // Face toward +y
+} RaycastFace;
+
+#define RAYCAST_PALETTE_SIZE 256 // Entries in an indexed texture palette
+#define RAYCAST_FOG_LEVELS   32 // Fog steps in precomputed palette shades
+
+/**
+ * @struct RaycastPalette
+ * @brief 256-color ARGB palette for indexed textures, optionally with precomputed shades
+ *
+ * @param colors ARGB palette entries
+ * @param shades Palette variants for both wall sides and every fog level, laid out as
+ *               [side][fog level][index] (NULL until raycast_palette_build_shades is called)
+ * @param shadeFogColor Fog color the shades were built for
+ */
+typedef struct {
+    RaycastColor  colors[RAYCAST_PALETTE_SIZE];
+    RaycastColor* shades;
+    RaycastColor  shadeFogColor;
+} RaycastPalette;
 
 /**
  * @struct RaycastTexture
  * @brief Texture structure for wall rendering
  *
- * @param pixels ARGB pixel data
+ * A texture either stores ARGB pixels, or 8-bit palette indices and a palette.
+ *
+ * @param pixels ARGB pixel data (NULL for indexed textures)
  * @param width Width of the texture
  * @param height Height of the texture
+ * @param indices 8-bit palette indices (NULL for ARGB textures)
+ * @param palette Palette of an indexed texture; may be shared between textures and swapped
+ * @param ownsPalette Whether the palette is destroyed together with the texture
+ * @param arenaOwned Whether the texture lives in a RaycastArena (raycast_texture_destroy is a
+ *                   no-op)
+ * @param translucent Whether walls behind the texture show through texels with alpha below 255
+ *                    (see raycast_texture_scan_alpha)
  */
 typedef struct {
-    RaycastColor* pixels;
-    int           width;
-    int           height;
+    RaycastColor*   pixels;
+    int             width;
+    int             height;
+    uint8_t*        indices;
+    RaycastPalette* palette;
+    int             ownsPalette;
+    int             arenaOwned;
+    int             translucent;
 } RaycastTexture;
 
 /**
@@ -34,33 +87,104 @@ typedef struct {
  * @param wallX Position where the wall was hit (0.0 to 1.0)
  * @param side Which side of the wall was hit (0 = vertical, 1 = horizontal)
  * @param textureId ID of the texture to use
+ * @param cell Index of the hit cell in the map (y * width + x), or -1 if nothing was hit
  */
 typedef struct {
     float distance;
     float wallX;
     int   side;
     int   textureId;
+    int   cell;
 } RaycastHit;
 
 /**
- * @struct Raycaster
- * @brief Raycaster structure
+ * @struct RaycastHitList
+ * @brief Fixed-size list of the wall layers one ray sees, filled by raycast_cast_layers()
  *
- * @param map 1D array representing the 2D map (RaycastColor if untextured, RaycastTexture if textured)
- * @param width Width of the map
- * @param height Height of the map
- * @param textures Array of textures
- * @param textureCount Number of textures
- * @param textured Whether to use textures
+ * @param hits The hits, nearest first; all but the last are translucent
+ * @param count Number of hits
  */
 typedef struct {
-    RaycastColor*    map;
-    int              width;
-    int              height;
-    RaycastTexture** textures;
-    int              textureCount;
-    int              textured;
-} Raycaster;
+    RaycastHit hits[RAYCAST_MAX_HITS];
+    int        count;
+} RaycastHitList;
+
+/**
+ * @struct RaycastGBuffer
+ * @brief Caller-provided per-column hit data filled by the *_gbuffer render functions
+ *
+ * Each array holds one entry per rendered column (count * w entries for batched
+ * rendering). Any array may be NULL to skip that field.
+ *
+ * @param distance Distance to the hit wall, 0 if nothing was hit
+ * @param cell Map index of the hit cell, -1 if nothing was hit
+ * @param textureId Texture ID (or color, for untextured maps) of the hit cell, -1 if nothing was
+ *                  hit
+ * @param side Which side of the wall was hit (0 = vertical, 1 = horizontal)
+ * @param wallX Position where the wall was hit (0.0 to 1.0)
+ */
+typedef struct {
+    float*   distance;
+    int*     cell;
+    int*     textureId;
+    uint8_t* side;
+    float*   wallX;
+} RaycastGBuffer;
+
+/**
+ * @struct RaycastArena
+ * @brief Bump allocator that keeps a level's resources in one contiguous block
+ *
+ * @param base Start of the reserved block
+ * @param capacity Size of the reserved block in bytes
+ * @param used Number of bytes handed out so far
+ */
+typedef struct {
+    uint8_t* base;
+    size_t   capacity;
+    size_t   used;
+} RaycastArena;
+
+/**
+ * @struct RaycastCellType
+ * @brief Properties shared by all cells of one type in a compact map
+ *
+ * @param color Wall color, used when textureId is -1
+ * @param textureId ID of the texture to use, or -1 to draw color
+ * @param solid Whether the cell blocks movement (non-solid cells are still drawn)
+ * @param translucent Whether walls behind a colored cell show through by the alpha of color
+ *                    (textured cells use the flag of their texture)
+ */
+typedef struct {
+    RaycastColor color;
+    int          textureId;
+    int          solid;
+    int          translucent;
+} RaycastCellType;
+
+/**
+ * @struct RaycastThinWall
+ * @brief Zero-thickness wall or sliding door panel inside a non-empty map cell
+ *
+ * Rays entering the cell hit the panel instead of the cell faces, and pass the cell if they
+ * miss it. A door slides along the panel as open goes from 0 to 1, so animating it is a
+ * write to open; the cell blocks movement until the door is fully open. Writes to open are
+ * not journaled: call raycast_mark_cell() when a door starts opening or finishes closing or
+ * opening, so map caches (pathfinders, visibility sets, lightmaps) pick up the change.
+ * Erasing the cell removes its thin wall.
+ *
+ * @param cell Index of the cell (y * width + x), set by raycast_set_thin_wall
+ * @param offset Position of the panel across the cell, from 0 to 1
+ * @param orientation RAYCAST_THIN_VERTICAL for a panel at x = offset, RAYCAST_THIN_HORIZONTAL
+ *                    for a panel at y = offset
+ * @param open Open fraction of the door, from 0 (closed) to 1 (fully open)
+ */
+typedef struct {
+    int                    cell;
+    float                  offset;
+    RaycastThinOrientation orientation;
+    float                  open;
+} RaycastThinWall;
 
 /**
  * @struct RaycastRect
@@ -78,6 +202,89 @@ typedef struct {
     float h;
 } RaycastRect;
 
+/**
+ * @struct RaycastLighting
+ * @brief Wall light levels the renderers apply, maintained by a RaycastLightmap
+ *
+ * @param levels Light level of every cell face, indexed by cell * 4 + RaycastFace, from 0
+ *               (black) to 255 (unlit color)
+ * @param width Width of the map the levels were computed for
+ * @param height Height of the map the levels were computed for
+ * @param table Channel lookup table: table[level][value] is value scaled by level / 255
+ */
+typedef struct {
+    uint8_t* levels;
+    int      width;
+    int      height;
+    uint8_t  table[256][256];
+} RaycastLighting;
+
+/**
+ * @struct Raycaster
+ * @brief Raycaster structure
+ *
+ * A Raycaster either stores a full RaycastColor per cell in map, or, when initialized with
+ * raycast_init_compact(), an 8- or 16-bit cell type ID per cell in cells that indexes
+ * cellTypes.
+ *
+ * Every raycast_draw(), raycast_erase(), thin wall change and raycast_mark_cell() bumps
+ * revision and records the clipped cell rectangle in a small ring journal, so caches built
+ * from the map can catch up with raycast_get_edits() instead of rebuilding.
+ *
+ * @param map 1D array representing the 2D map (RaycastColor if untextured, RaycastTexture if textured)
+ * @param width Width of the map
+ * @param height Height of the map
+ * @param textures Array of textures
+ * @param textureCount Number of textures
+ * @param textured Whether to use textures
+ * @param maxDistance Maximum view distance in cells; rays stop there (0 = unlimited)
+ * @param fogColor Color walls fade into as they approach maxDistance
+ * @param cells 1D array of cell type IDs for compact maps (NULL otherwise)
+ * @param cellBits Bits per cell: 8 or 16 for compact maps, 32 when map is used
+ * @param cellTypes Cell type table indexed by cell ID (entry 0 is the empty cell)
+ * @param cellTypeCount Number of entries in cellTypes
+ * @param arena Arena the Raycaster, its map and its arrays live in (NULL if heap allocated)
+ * @param textureCapacity Number of entries allocated in textures
+ * @param cellTypeCapacity Number of entries allocated in cellTypes
+ * @param rows Row pointers of a read-only snapshot view (NULL for a live map, see
+ *             raycast_snapshot_acquire)
+ * @param edits Ring journal of the last RAYCAST_EDIT_JOURNAL edited cell rectangles
+ * @param revision Number of edits made so far
+ * @param editBase Revision at which the journal was last reset (edits before it are lost)
+ * @param thinWalls Thin walls and doors of the map, sorted by cell
+ * @param thinWallCount Number of entries in thinWalls
+ * @param thinWallCapacity Number of entries allocated in thinWalls
+ * @param pixelFormat Pixel format raycast_render_buffer() and raycast_render_batch() write
+ *                    (values outside RaycastPixelFormat render nothing)
+ * @param lighting Wall light levels to apply, or NULL (see raycast_lightmap_create)
+ */
+typedef struct {
+    RaycastColor*          map;
+    int                    width;
+    int                    height;
+    RaycastTexture**       textures;
+    int                    textureCount;
+    int                    textured;
+    float                  maxDistance;
+    RaycastColor           fogColor;
+    void*                  cells;
+    int                    cellBits;
+    RaycastCellType*       cellTypes;
+    int                    cellTypeCount;
+    RaycastArena*          arena;
+    int                    textureCapacity;
+    int                    cellTypeCapacity;
+    const void**           rows;
+    RaycastRect            edits[RAYCAST_EDIT_JOURNAL];
+    Uint64                 revision;
+    Uint64                 editBase;
+    RaycastThinWall*       thinWalls;
+    int                    thinWallCount;
+    int                    thinWallCapacity;
+    RaycastPixelFormat     pixelFormat;
+    const RaycastLighting* lighting;
+} Raycaster;
+
 /**
  * @struct RaycastCamera
  * @brief Raycast camera structure
@@ -100,32 +307,352 @@ typedef struct {
     int   fov;
 } RaycastCamera;
 
+/**
+ * @struct RaycastTerrain
+ * @brief Height field drawn by raycast_render_terrain(), colored by the cells of the map
+ *
+ * Heights are in cells, like the walls of the grid renderer, which are 1 cell tall.
+ *
+ * @param heights One height step per map cell (y * width + x)
+ * @param scale Height of one height step
+ * @param eye Height of the camera
+ * @param pitch Screen rows the horizon is moved down from the middle of the view
+ * @param distance Farthest distance drawn
+ * @param step Distance between the first samples of a column
+ * @param lod Growth of the sample spacing per unit of distance (0 = constant spacing)
+ */
+typedef struct {
+    const uint8_t* heights;
+    float          scale;
+    float          eye;
+    float          pitch;
+    float          distance;
+    float          step;
+    float          lod;
+} RaycastTerrain;
+
+/**
+ * @struct RaycastThreadPool
+ * @brief Opaque pool of persistent worker threads (see raycast_thread_pool_create)
+ */
+typedef struct RaycastThreadPool RaycastThreadPool;
+
+/**
+ * @struct RaycastSnapshots
+ * @brief Opaque copy-on-write epoch store of a map for lock-free readers (see
+ * raycast_snapshots_create)
+ */
+typedef struct RaycastSnapshots RaycastSnapshots;
+
+/**
+ * @struct RaycastPipeline
+ * @brief Opaque render-on-worker, present-on-caller frame pipeline (see raycast_pipeline_create)
+ */
+typedef struct RaycastPipeline RaycastPipeline;
+
+/**
+ * @struct RaycastPipelineStats
+ * @brief Frame and latency counters of a RaycastPipeline
+ *
+ * Latencies are measured from the input timestamp passed to raycast_pipeline_submit() to the
+ * return of SDL_RenderPresent() for that frame, in nanoseconds.
+ *
+ * @param submitted Number of frames submitted
+ * @param skipped Number of submitted frames replaced by a newer one before rendering started
+ * @param rendered Number of frames rendered
+ * @param dropped Number of rendered frames replaced by a newer one before being drawn, plus
+ *                frames not rendered because the Raycaster pixel format changed
+ * @param presented Number of frames presented
+ * @param lastLatency Input-to-present latency of the last presented frame
+ * @param averageLatency Mean input-to-present latency of all presented frames
+ * @param maxLatency Highest input-to-present latency seen
+ */
+typedef struct {
+    Uint64 submitted;
+    Uint64 skipped;
+    Uint64 rendered;
+    Uint64 dropped;
+    Uint64 presented;
+    Uint64 lastLatency;
+    Uint64 averageLatency;
+    Uint64 maxLatency;
+} RaycastPipelineStats;
+
+/**
+ * @struct RaycastStream
+ * @brief Opaque headless renderer that streams frames to a file descriptor (see
+ * raycast_stream_create)
+ */
+typedef struct RaycastStream RaycastStream;
+
+/**
+ * @struct RaycastStreamStats
+ * @brief Frame counters of a RaycastStream
+ *
+ * @param rendered Number of frames rendered and queued for writing
+ * @param dropped Number of frames skipped because every frame buffer was still queued
+ * @param written Number of frames written out
+ * @param bytes Number of bytes written, including the Y4M header
+ * @param failed Whether a write failed; queued frames are discarded from then on
+ */
+typedef struct {
+    Uint64 rendered;
+    Uint64 dropped;
+    Uint64 written;
+    Uint64 bytes;
+    bool   failed;
+} RaycastStreamStats;
+
+/**
+ * @struct RaycastVisibility
+ * @brief Opaque potentially visible set of a map for line-of-sight queries (see
+ * raycast_visibility_create)
+ */
+typedef struct RaycastVisibility RaycastVisibility;
+
+/**
+ * @struct RaycastLightmap
+ * @brief Opaque per-face light levels of a map, relit incrementally (see
+ * raycast_lightmap_create)
+ */
+typedef struct RaycastLightmap RaycastLightmap;
+
+/**
+ * @struct RaycastLight
+ * @brief Point light of a RaycastLightmap
+ *
+ * @param x X coordinate of the light
+ * @param y Y coordinate of the light
+ * @param radius Distance at which the light fades out
+ * @param intensity Light level added to faces right next to the light (0 to 255)
+ */
+typedef struct {
+    float x;
+    float y;
+    float radius;
+    int   intensity;
+} RaycastLight;
+
+/**
+ * @struct RaycastBodies
+ * @brief Structure-of-arrays state of circular bodies moved by raycast_move_bodies()
+ *
+ * @param x X coordinates of the centers
+ * @param y Y coordinates of the centers
+ * @param vx X velocities in cells per time unit
+ * @param vy Y velocities in cells per time unit
+ * @param radius Radii of the bodies
+ * @param count Number of bodies
+ */
+typedef struct {
+    float*       x;
+    float*       y;
+    float*       vx;
+    float*       vy;
+    const float* radius;
+    int          count;
+} RaycastBodies;
+
+/**
+ * @struct RaycastGrid
+ * @brief Cached raycast_collides() result of every cell of a map, shared by the map caches
+ * and kept up to date through the edit journal (see raycast_grid_sync)
+ *
+ * @param raycaster The Raycaster whose map is cached
+ * @param width Width of the cached grid
+ * @param height Height of the cached grid
+ * @param blocked Whether the center of each cell collides
+ * @param revision Edit revision of the map the grid reflects
+ */
+typedef struct {
+    Raycaster* raycaster;
+    int        width;
+    int        height;
+    uint8_t*   blocked;
+    Uint64     revision;
+} RaycastGrid;
+
+/**
+ * @struct RaycastPathfinder
+ * @brief Opaque Jump Point Search pathfinder over the cells of a map (see
+ * raycast_pathfinder_create)
+ */
+typedef struct RaycastPathfinder RaycastPathfinder;
+
+/**
+ * @struct RaycastPathQuery
+ * @brief One path request of a batch passed to raycast_find_paths()
+ *
+ * @param startX X coordinate of the start cell
+ * @param startY Y coordinate of the start cell
+ * @param goalX X coordinate of the goal cell
+ * @param goalY Y coordinate of the goal cell
+ * @param path Receives x, y pairs of the waypoints from start to goal
+ * @param capacity Number of waypoints path has room for
+ * @param length Number of waypoints of the path found, or 0 if the goal is unreachable
+ */
+typedef struct {
+    int  startX;
+    int  startY;
+    int  goalX;
+    int  goalY;
+    int* path;
+    int  capacity;
+    int  length;
+} RaycastPathQuery;
+
+/**
+ * @brief Task function run by raycast_thread_pool_run for each task index
+ *
+ * @param data User data passed to raycast_thread_pool_run
+ * @param index Task index in [0, count)
+ */
+typedef void (*RaycastTask)(void* data, int index);
+
 float           raycast_cast(Raycaster*, float, float, float, RaycastColor*);
 void            raycast_cast_textured(Raycaster*, float, float, float, RaycastHit*);
+void            raycast_cast_layers(Raycaster*, float, float, float, RaycastHitList*);
 RaycastTexture* raycast_texture_create(int, int);
+RaycastTexture* raycast_texture_create_arena(RaycastArena*, int, int);
+RaycastTexture* raycast_texture_create_indexed(int, int, RaycastPalette*);
 void            raycast_texture_destroy(RaycastTexture*);
+RaycastTexture* raycast_texture_to_indexed(const RaycastTexture*, RaycastPalette*);
+bool            raycast_texture_scan_alpha(RaycastTexture*);
+RaycastTexture* raycast_texture_load(const char*, const char*);
+int raycast_texture_load_set(const char**, int, RaycastTexture**, RaycastThreadPool*, const char*);
+RaycastPalette* raycast_palette_create(const RaycastColor*, int);
+void            raycast_palette_destroy(RaycastPalette*);
+int             raycast_palette_build_shades(RaycastPalette*, RaycastColor);
 void            raycast_add_texture(Raycaster*, RaycastTexture*);
+int             raycast_add_cell_type(Raycaster*, const RaycastCellType*);
 bool            raycast_collides(Raycaster*, float, float);
 void            raycast_destroy(Raycaster*);
-void            raycast_draw(Raycaster*, const RaycastRect*, const RaycastColor*);
+int             raycast_draw(Raycaster*, const RaycastRect*, const RaycastColor*);
 void            raycast_erase(Raycaster*, const RaycastRect*);
+int             raycast_get_cell(const Raycaster*, int, int);
 Raycaster*      raycast_init(int, int);
+Raycaster*      raycast_init_arena(RaycastArena*, int, int, int, int);
+Raycaster*      raycast_init_compact(int, int, int);
+int             raycast_init_compact_ptr(Raycaster*, int, int, int);
 int             raycast_init_ptr(Raycaster*, int, int);
+int             raycast_get_edits(const Raycaster*, Uint64, RaycastRect*);
+void            raycast_mark_cell(Raycaster*, int, int);
 void            raycast_move_camera(RaycastCamera*, RaycastDirection, float);
 void raycast_move_camera_with_collision(Raycaster*, RaycastCamera*, RaycastDirection, float);
+void raycast_move_bodies(Raycaster*, const RaycastBodies*, float, RaycastThreadPool*);
 void raycast_render(Raycaster*, const RaycastCamera*, SDL_Renderer*, int, int, const RaycastColor*);
+void raycast_render_gbuffer(Raycaster*,
+                            const RaycastCamera*,
+                            SDL_Renderer*,
+                            int,
+                            int,
+                            const RaycastColor*,
+                            RaycastGBuffer*);
 void raycast_render_textured(
     Raycaster*, const RaycastCamera*, SDL_Renderer*, int, int, const RaycastColor*);
-void        raycast_render_2d(Raycaster*,
-                              const RaycastCamera*,
-                              SDL_Renderer*,
-                              int,
-                              float,
-                              const RaycastColor*,
-                              const RaycastColor*,
-                              const RaycastColor*);
-void        raycast_rotate_camera(RaycastCamera*, float);
-void        raycast_set_draw_color(SDL_Renderer*, const RaycastColor*);
-const char* raycast_version(void);
+void raycast_render_textured_gbuffer(Raycaster*,
+                                     const RaycastCamera*,
+                                     SDL_Renderer*,
+                                     int,
+                                     int,
+                                     const RaycastColor*,
+                                     RaycastGBuffer*);
+void raycast_render_buffer(
+    Raycaster*, const RaycastCamera*, void*, float*, int, int, const RaycastColor*);
+void              raycast_render_buffer_gbuffer(Raycaster*,
+                                                const RaycastCamera*,
+                                                void*,
+                                                float*,
+                                                int,
+                                                int,
+                                                const RaycastColor*,
+                                                RaycastGBuffer*);
+void              raycast_render_batch(Raycaster*,
+                                       const RaycastCamera*,
+                                       int,
+                                       RaycastThreadPool*,
+                                       void*,
+                                       float*,
+                                       int,
+                                       int,
+                                       const RaycastColor*);
+void              raycast_render_batch_gbuffer(Raycaster*,
+                                               const RaycastCamera*,
+                                               int,
+                                               RaycastThreadPool*,
+                                               void*,
+                                               float*,
+                                               int,
+                                               int,
+                                               const RaycastColor*,
+                                               RaycastGBuffer*);
+void              raycast_render_2d(Raycaster*,
+                                    const RaycastCamera*,
+                                    SDL_Renderer*,
+                                    int,
+                                    float,
+                                    const RaycastColor*,
+                                    const RaycastColor*,
+                                    const RaycastColor*);
+void              raycast_rotate_camera(RaycastCamera*, float);
+void              raycast_set_draw_color(SDL_Renderer*, const RaycastColor*);
+int               raycast_pixel_size(RaycastPixelFormat);
+SDL_PixelFormat   raycast_pixel_format_sdl(RaycastPixelFormat);
+Uint32            raycast_convert_color(RaycastColor, RaycastPixelFormat);
+int               raycast_set_thin_wall(Raycaster*, int, int, const RaycastThinWall*);
+void              raycast_remove_thin_wall(Raycaster*, int, int);
+RaycastThinWall*  raycast_get_thin_wall(Raycaster*, int, int);
+RaycastSnapshots* raycast_snapshots_create(Raycaster*, int);
+void              raycast_snapshots_destroy(RaycastSnapshots*);
+int               raycast_snapshots_publish(RaycastSnapshots*);
+Raycaster*        raycast_snapshot_acquire(RaycastSnapshots*, int);
+void              raycast_snapshot_release(RaycastSnapshots*, int);
+RaycastPipeline*  raycast_pipeline_create(Raycaster*, SDL_Renderer*, RaycastThreadPool*, int, int);
+void              raycast_pipeline_destroy(RaycastPipeline*);
+void raycast_pipeline_submit(RaycastPipeline*, const RaycastCamera*, const RaycastColor*, Uint64);
+void raycast_pipeline_wait(RaycastPipeline*);
+bool raycast_pipeline_draw(RaycastPipeline*);
+void raycast_pipeline_present(RaycastPipeline*);
+void raycast_pipeline_stats(RaycastPipeline*, RaycastPipelineStats*);
+void raycast_render_terrain(Raycaster*,
+                            const RaycastTerrain*,
+                            const RaycastCamera*,
+                            RaycastThreadPool*,
+                            void*,
+                            int,
+                            int,
+                            const RaycastColor*);
+RaycastStream*
+raycast_stream_create(Raycaster*, RaycastThreadPool*, int, RaycastStreamFormat, int, int, int, int);
+void raycast_stream_destroy(RaycastStream*);
+bool raycast_stream_frame(RaycastStream*, const RaycastCamera*, const RaycastColor*);
+int  raycast_stream_path(RaycastStream*, const RaycastCamera*, int, const RaycastColor*);
+void raycast_stream_flush(RaycastStream*);
+void raycast_stream_stats(RaycastStream*, RaycastStreamStats*);
+int  raycast_grid_sync(RaycastGrid*, RaycastRect*, int*);
+void raycast_grid_free(RaycastGrid*);
+RaycastPathfinder* raycast_pathfinder_create(Raycaster*);
+void               raycast_pathfinder_destroy(RaycastPathfinder*);
+int                raycast_find_path(RaycastPathfinder*, int, int, int, int, int*, int);
+void raycast_find_paths(RaycastPathfinder*, RaycastPathQuery*, int, RaycastThreadPool*);
+RaycastVisibility* raycast_visibility_create(Raycaster*, RaycastThreadPool*);
+void               raycast_visibility_destroy(RaycastVisibility*);
+int                raycast_visibility_update(RaycastVisibility*, RaycastThreadPool*);
+bool               raycast_line_of_sight(const RaycastVisibility*, int, int, int, int);
+RaycastLightmap*   raycast_lightmap_create(Raycaster*, int, RaycastThreadPool*);
+void               raycast_lightmap_destroy(RaycastLightmap*);
+int                raycast_lightmap_add_light(RaycastLightmap*, const RaycastLight*);
+void               raycast_lightmap_set_light(RaycastLightmap*, int, const RaycastLight*);
+void               raycast_lightmap_remove_light(RaycastLightmap*, int);
+int                raycast_lightmap_update(RaycastLightmap*, RaycastThreadPool*);
+RaycastArena*      raycast_arena_create(size_t);
+void               raycast_arena_destroy(RaycastArena*);
+void               raycast_arena_reset(RaycastArena*);
+void*              raycast_arena_alloc(RaycastArena*, size_t);
+RaycastThreadPool* raycast_thread_pool_create(int);
+void               raycast_thread_pool_destroy(RaycastThreadPool*);
+void               raycast_thread_pool_run(RaycastThreadPool*, RaycastTask, void*, int);
+int                raycast_thread_pool_size(const RaycastThreadPool*);
+const char*        raycast_version(void);
 
 #endif
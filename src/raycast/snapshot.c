@@ -0,0 +1,338 @@
+#include "raycast.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief A block of RAYCAST_SNAPSHOT_ROWS map rows shared by every epoch it did not change in.
+ *
+ * @param refs Number of epochs referencing the chunk
+ * @param data Copied cells of the rows
+ */
+typedef struct {
+    int     refs;
+    uint8_t data[];
+} SnapshotChunk;
+
+/**
+ * @brief One immutable published version of the map.
+ *
+ * @param view Read-only Raycaster that reads cells through the row pointers of the epoch
+ * @param chunks Row chunks of the epoch
+ * @param chunkCount Number of chunks
+ * @param next Next epoch in the retired list
+ */
+typedef struct SnapshotEpoch {
+    Raycaster             view;
+    SnapshotChunk**       chunks;
+    int                   chunkCount;
+    struct SnapshotEpoch* next;
+} SnapshotEpoch;
+
+/**
+ * @struct RaycastSnapshots
+ * @brief Copy-on-write epochs of a live map.
+ *
+ * The writer edits the live Raycaster as usual and calls raycast_snapshots_publish(), which
+ * copies only the row chunks the edit journal reports as changed. Readers pin the current
+ * epoch in their own slot, so neither side takes a lock; retired epochs are freed once no
+ * slot holds them.
+ *
+ * @param raycaster The live Raycaster the epochs are copied from
+ * @param slots Epoch pinned by each reader (NULL if none)
+ * @param readerCount Number of reader slots
+ * @param current The newest published epoch
+ * @param retired Replaced epochs that may still be pinned
+ * @param revision Edit revision of the live map the current epoch reflects
+ */
+struct RaycastSnapshots {
+    Raycaster*     raycaster;
+    void**         slots;
+    int            readerCount;
+    void*          current;
+    SnapshotEpoch* retired;
+    Uint64         revision;
+};
+
+/**
+ * @brief Free an epoch and every chunk no other epoch references.
+ *
+ * @param epoch The epoch to free.
+ */
+static void epoch_free(SnapshotEpoch* epoch) {
+    for (int i = 0; i < epoch->chunkCount; i++) {
+        if (epoch->chunks[i] && --epoch->chunks[i]->refs == 0) {
+            free(epoch->chunks[i]);
+        }
+    }
+    free(epoch->chunks);
+    free((void*) epoch->view.rows);
+    free(epoch->view.textures);
+    free(epoch->view.cellTypes);
+    free(epoch->view.thinWalls);
+    free(epoch);
+}
+
+/**
+ * @brief Check whether any reader has an epoch pinned.
+ *
+ * @param snapshots The snapshot store.
+ * @param epoch The epoch.
+ * @return true if a reader slot holds the epoch.
+ */
+static bool epoch_pinned(RaycastSnapshots* snapshots, const SnapshotEpoch* epoch) {
+    for (int i = 0; i < snapshots->readerCount; i++) {
+        if (SDL_GetAtomicPointer(&snapshots->slots[i]) == epoch) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Free the retired epochs no reader holds anymore.
+ *
+ * @param snapshots The snapshot store.
+ */
+static void reclaim(RaycastSnapshots* snapshots) {
+    SnapshotEpoch** link = &snapshots->retired;
+    while (*link) {
+        SnapshotEpoch* epoch = *link;
+        if (epoch_pinned(snapshots, epoch)) {
+            link = &epoch->next;
+        } else {
+            *link = epoch->next;
+            epoch_free(epoch);
+        }
+    }
+}
+
+/**
+ * @brief Copy rows of the live map into a new chunk.
+ *
+ * @param live The live Raycaster.
+ * @param first First row to copy.
+ * @param rows Number of rows to copy.
+ * @param rowBytes Size of one row in bytes.
+ * @return The new chunk with one reference, or NULL on allocation failure.
+ */
+static SnapshotChunk* chunk_create(const Raycaster* live, int first, int rows, size_t rowBytes) {
+    SnapshotChunk* chunk = (SnapshotChunk*) malloc(sizeof(SnapshotChunk) + rows * rowBytes);
+    if (!chunk) {
+        return NULL;
+    }
+
+    const uint8_t* cells
+        = (live->cellBits == 32) ? (const uint8_t*) live->map : (const uint8_t*) live->cells;
+    memcpy(chunk->data, cells + first * rowBytes, rows * rowBytes);
+    chunk->refs = 1;
+    return chunk;
+}
+
+/**
+ * @brief Create a snapshot store for a live map and publish its first epoch.
+ *
+ * @param raycaster The live Raycaster. Only the writer thread may edit it.
+ * @param readers Number of reader slots (one per thread that acquires snapshots).
+ * @return The newly allocated snapshot store, or NULL on failure.
+ */
+RaycastSnapshots* raycast_snapshots_create(Raycaster* raycaster, int readers) {
+    if (!raycaster || readers <= 0) {
+        return NULL;
+    }
+
+    RaycastSnapshots* snapshots = (RaycastSnapshots*) calloc(1, sizeof(RaycastSnapshots));
+    if (!snapshots) {
+        return NULL;
+    }
+
+    snapshots->raycaster   = raycaster;
+    snapshots->readerCount = readers;
+    snapshots->slots       = (void**) calloc(readers, sizeof(void*));
+    if (!snapshots->slots || raycast_snapshots_publish(snapshots)) {
+        raycast_snapshots_destroy(snapshots);
+        return NULL;
+    }
+
+    return snapshots;
+}
+
+/**
+ * @brief Free a snapshot store and all of its epochs.
+ *
+ * No reader may hold a snapshot anymore.
+ *
+ * @param snapshots The snapshot store to destroy.
+ */
+void raycast_snapshots_destroy(RaycastSnapshots* snapshots) {
+    if (!snapshots) {
+        return;
+    }
+
+    SnapshotEpoch* current = (SnapshotEpoch*) SDL_GetAtomicPointer(&snapshots->current);
+    if (current) {
+        epoch_free(current);
+    }
+    while (snapshots->retired) {
+        SnapshotEpoch* next = snapshots->retired->next;
+        epoch_free(snapshots->retired);
+        snapshots->retired = next;
+    }
+    free(snapshots->slots);
+    free(snapshots);
+}
+
+/**
+ * @brief Publish the current state of the live map as a new epoch.
+ *
+ * Row chunks touched by edits since the last publish are copied; all others are shared with
+ * the previous epoch. Must be called from the writer thread. Retired epochs that no reader
+ * holds anymore are freed.
+ *
+ * @param snapshots The snapshot store.
+ * @return 0 on success, 1 on allocation failure (the previous epoch stays current).
+ */
+int raycast_snapshots_publish(RaycastSnapshots* snapshots) {
+    Raycaster*     live       = snapshots->raycaster;
+    SnapshotEpoch* previous   = (SnapshotEpoch*) SDL_GetAtomicPointer(&snapshots->current);
+    size_t         rowBytes   = (size_t) live->width * (live->cellBits / 8);
+    int            chunkCount = (live->height + RAYCAST_SNAPSHOT_ROWS - 1) / RAYCAST_SNAPSHOT_ROWS;
+    RaycastRect    edits[RAYCAST_EDIT_JOURNAL];
+    int            editCount = raycast_get_edits(live, snapshots->revision, edits);
+
+    if (!previous || previous->view.width != live->width || previous->view.height != live->height
+        || previous->view.cellBits != live->cellBits) {
+        editCount = -1;
+    }
+
+    SnapshotEpoch* epoch = (SnapshotEpoch*) calloc(1, sizeof(SnapshotEpoch));
+    if (!epoch) {
+        return 1;
+    }
+    epoch->chunks    = (SnapshotChunk**) calloc(chunkCount, sizeof(SnapshotChunk*));
+    epoch->view.rows = (const void**) malloc(live->height * sizeof(void*));
+    if (!epoch->chunks || !epoch->view.rows) {
+        epoch_free(epoch);
+        return 1;
+    }
+
+    // Share every chunk, then drop the ones an edit touched so they get copied below
+    if (editCount >= 0) {
+        memcpy(epoch->chunks, previous->chunks, chunkCount * sizeof(SnapshotChunk*));
+        for (int i = 0; i < editCount; i++) {
+            int first = (int) edits[i].y / RAYCAST_SNAPSHOT_ROWS;
+            int last  = ((int) edits[i].y + (int) edits[i].h - 1) / RAYCAST_SNAPSHOT_ROWS;
+            for (int c = first; c <= last; c++) {
+                epoch->chunks[c] = NULL;
+            }
+        }
+    }
+
+    for (int c = 0; c < chunkCount; c++) {
+        int first = c * RAYCAST_SNAPSHOT_ROWS;
+        int rows  = SDL_min(RAYCAST_SNAPSHOT_ROWS, live->height - first);
+        if (epoch->chunks[c]) {
+            epoch->chunks[c]->refs++;
+        } else if (!(epoch->chunks[c] = chunk_create(live, first, rows, rowBytes))) {
+            epoch_free(epoch);
+            return 1;
+        }
+        epoch->chunkCount = c + 1;
+        for (int y = 0; y < rows; y++) {
+            epoch->view.rows[first + y] = epoch->chunks[c]->data + y * rowBytes;
+        }
+    }
+
+    // The view keeps its own copies of the arrays the writer may reallocate
+    const void** rows     = epoch->view.rows;
+    epoch->view           = *live;
+    epoch->view.rows      = rows;
+    epoch->view.map       = NULL;
+    epoch->view.cells     = NULL;
+    epoch->view.arena     = NULL;
+    epoch->view.textures  = NULL;
+    epoch->view.cellTypes = NULL;
+    epoch->view.thinWalls = NULL;
+    epoch->view.lighting  = NULL;
+    if (live->textureCount > 0) {
+        epoch->view.textures
+            = (RaycastTexture**) malloc(live->textureCount * sizeof(RaycastTexture*));
+        if (!epoch->view.textures) {
+            epoch_free(epoch);
+            return 1;
+        }
+        memcpy(epoch->view.textures, live->textures, live->textureCount * sizeof(RaycastTexture*));
+    }
+    if (live->cellTypeCount > 0) {
+        epoch->view.cellTypes
+            = (RaycastCellType*) malloc(live->cellTypeCount * sizeof(RaycastCellType));
+        if (!epoch->view.cellTypes) {
+            epoch_free(epoch);
+            return 1;
+        }
+        memcpy(epoch->view.cellTypes,
+               live->cellTypes,
+               live->cellTypeCount * sizeof(RaycastCellType));
+    }
+    if (live->thinWallCount > 0) {
+        epoch->view.thinWalls
+            = (RaycastThinWall*) malloc(live->thinWallCount * sizeof(RaycastThinWall));
+        if (!epoch->view.thinWalls) {
+            epoch_free(epoch);
+            return 1;
+        }
+        memcpy(epoch->view.thinWalls,
+               live->thinWalls,
+               live->thinWallCount * sizeof(RaycastThinWall));
+    }
+    epoch->view.textureCapacity  = live->textureCount;
+    epoch->view.cellTypeCapacity = live->cellTypeCount;
+    epoch->view.thinWallCapacity = live->thinWallCount;
+
+    SDL_SetAtomicPointer(&snapshots->current, epoch);
+    if (previous) {
+        previous->next     = snapshots->retired;
+        snapshots->retired = previous;
+    }
+    snapshots->revision = live->revision;
+
+    reclaim(snapshots);
+    return 0;
+}
+
+/**
+ * @brief Pin the current epoch for a reader.
+ *
+ * The returned view stays valid and unchanged until the reader releases it, no matter what
+ * the writer publishes meanwhile. It may be passed to the casting, collision and rendering
+ * functions, but must not be edited or destroyed. The view has no lighting, since the live
+ * lightmap is relit and freed independently of the epochs, so it renders unlit. Acquiring
+ * again replaces the reader's pin.
+ *
+ * @param snapshots The snapshot store.
+ * @param reader The reader slot, in [0, readers).
+ * @return The read-only view of the pinned epoch.
+ */
+Raycaster* raycast_snapshot_acquire(RaycastSnapshots* snapshots, int reader) {
+    void**         slot = &snapshots->slots[reader];
+    SnapshotEpoch* epoch;
+
+    // Publish the pin, then make sure the epoch was not retired before the writer could see it
+    do {
+        epoch = (SnapshotEpoch*) SDL_GetAtomicPointer(&snapshots->current);
+        SDL_SetAtomicPointer(slot, epoch);
+    } while (SDL_GetAtomicPointer(&snapshots->current) != epoch);
+
+    return &epoch->view;
+}
+
+/**
+ * @brief Release the epoch a reader has pinned.
+ *
+ * @param snapshots The snapshot store.
+ * @param reader The reader slot, in [0, readers).
+ */
+void raycast_snapshot_release(RaycastSnapshots* snapshots, int reader) {
+    SDL_SetAtomicPointer(&snapshots->slots[reader], NULL);
+}
@@ -0,0 +1,437 @@
+#include "raycast.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @struct RaycastStream
+ * @brief Headless renderer that streams frames to a file descriptor.
+ *
+ * Frames are rendered on the caller's thread (spread over the pool when one is given) into a
+ * ring of reusable frame buffers. A dedicated writer thread converts the queued frames to the
+ * stream format and writes them out, so rendering never waits on I/O; a frame is dropped
+ * instead when every buffer is still queued.
+ *
+ * @param raycaster The Raycaster frames are rendered from
+ * @param pool Thread pool the columns of a frame are spread over, or NULL
+ * @param fd File descriptor frames are written to (not closed by the stream)
+ * @param format Output format of the stream
+ * @param pixelFormat Pixel format of the frame buffers, taken from the Raycaster at creation
+ * @param w The width of a frame
+ * @param h The height of a frame
+ * @param fps Frame rate written to the Y4M header
+ * @param buffers The ring of frame buffers
+ * @param ringSize Number of frame buffers
+ * @param out Writer-owned scratch a frame is converted into before it is written
+ * @param outSize Size of one converted frame in bytes
+ * @param thread The writer thread
+ * @param lock Protects everything below
+ * @param wake Signalled when a frame is queued or the stream is shutting down
+ * @param done Signalled when the writer finishes a frame
+ * @param head Buffer of the oldest queued frame
+ * @param queued Number of queued frames, including the one being written
+ * @param quit Set when the stream is being destroyed
+ * @param stats Frame counters
+ */
+struct RaycastStream {
+    Raycaster*          raycaster;
+    RaycastThreadPool*  pool;
+    int                 fd;
+    RaycastStreamFormat format;
+    RaycastPixelFormat  pixelFormat;
+    int                 w;
+    int                 h;
+    int                 fps;
+    void**              buffers;
+    int                 ringSize;
+    uint8_t*            out;
+    size_t              outSize;
+    SDL_Thread*         thread;
+    SDL_Mutex*          lock;
+    SDL_Condition*      wake;
+    SDL_Condition*      done;
+    int                 head;
+    int                 queued;
+    bool                quit;
+    RaycastStreamStats  stats;
+};
+
+/**
+ * @brief Write a whole block to a file descriptor, retrying short and interrupted writes.
+ *
+ * @param fd The file descriptor.
+ * @param data The bytes to write.
+ * @param size Number of bytes to write.
+ * @return true on success, false on a write error.
+ */
+static bool write_all(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= (size_t) written;
+    }
+    return true;
+}
+
+/**
+ * @brief Read the red, green and blue channels of a framebuffer pixel.
+ *
+ * @param pixels The framebuffer.
+ * @param format The pixel format of the framebuffer.
+ * @param index Index of the pixel.
+ * @param rgb Set to the 8-bit red, green and blue channels.
+ */
+static inline void
+pixel_rgb(const void* pixels, RaycastPixelFormat format, size_t index, int rgb[3]) {
+    if (format == RAYCAST_PIXEL_RGB565) {
+        uint16_t pixel = ((const uint16_t*) pixels)[index];
+        rgb[0]         = ((pixel >> 11) & 0x1F) * 255 / 31;
+        rgb[1]         = ((pixel >> 5) & 0x3F) * 255 / 63;
+        rgb[2]         = (pixel & 0x1F) * 255 / 31;
+        return;
+    }
+
+    Uint32 pixel = ((const Uint32*) pixels)[index];
+    int    red   = (format == RAYCAST_PIXEL_ABGR8888) ? 0 : 16;
+    rgb[0]       = (pixel >> red) & 0xFF;
+    rgb[1]       = (pixel >> 8) & 0xFF;
+    rgb[2]       = (pixel >> (16 - red)) & 0xFF;
+}
+
+/**
+ * @brief Convert a frame to raw RGBA bytes (alpha always 255).
+ *
+ * @param stream The stream.
+ * @param pixels The frame buffer.
+ */
+static void convert_rgba(RaycastStream* stream, const void* pixels) {
+    size_t   count = (size_t) stream->w * stream->h;
+    uint8_t* out   = stream->out;
+    for (size_t i = 0; i < count; i++, out += 4) {
+        int rgb[3];
+        pixel_rgb(pixels, stream->pixelFormat, i, rgb);
+        out[0] = (uint8_t) rgb[0];
+        out[1] = (uint8_t) rgb[1];
+        out[2] = (uint8_t) rgb[2];
+        out[3] = 0xFF;
+    }
+}
+
+/**
+ * @brief Convert a frame to a Y4M frame: a FRAME line and full-range 4:2:0 Y, Cb, Cr planes.
+ *
+ * Luma uses BT.601 weights; chroma is averaged over each 2x2 block (clipped at odd edges).
+ *
+ * @param stream The stream.
+ * @param pixels The frame buffer.
+ */
+static void convert_y4m(RaycastStream* stream, const void* pixels) {
+    int      w       = stream->w;
+    int      h       = stream->h;
+    int      chromaW = (w + 1) / 2;
+    int      chromaH = (h + 1) / 2;
+    uint8_t* luma    = stream->out + 6;
+    uint8_t* cb      = luma + (size_t) w * h;
+    uint8_t* cr      = cb + (size_t) chromaW * chromaH;
+
+    memcpy(stream->out, "FRAME\n", 6);
+    for (int cy = 0; cy < chromaH; cy++) {
+        for (int cx = 0; cx < chromaW; cx++) {
+            int sum[3] = { 0, 0, 0 };
+            int count  = 0;
+            for (int y = cy * 2; y < SDL_min(cy * 2 + 2, h); y++) {
+                for (int x = cx * 2; x < SDL_min(cx * 2 + 2, w); x++) {
+                    size_t index = (size_t) y * w + x;
+                    int    rgb[3];
+                    pixel_rgb(pixels, stream->pixelFormat, index, rgb);
+                    luma[index] = (uint8_t) ((77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2] + 128) >> 8);
+                    sum[0] += rgb[0];
+                    sum[1] += rgb[1];
+                    sum[2] += rgb[2];
+                    count++;
+                }
+            }
+            int    r     = sum[0] / count;
+            int    g     = sum[1] / count;
+            int    b     = sum[2] / count;
+
+            size_t index = (size_t) cy * chromaW + cx;
+            cb[index]    = (uint8_t) (128 + ((-43 * r - 85 * g + 128 * b + 128) >> 8));
+            cr[index]    = (uint8_t) (128 + ((128 * r - 107 * g - 21 * b + 128) >> 8));
+        }
+    }
+}
+
+/**
+ * @brief Writer thread entry point.
+ *
+ * @param data The owning stream.
+ * @return Always 0.
+ */
+static int stream_main(void* data) {
+    RaycastStream* stream = (RaycastStream*) data;
+    bool           failed = false;
+
+    if (stream->format == RAYCAST_STREAM_Y4M) {
+        char header[96];
+        // The planes hold full-range BT.601 samples, so the header says so
+        int size = snprintf(header,
+                            sizeof(header),
+                            "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n",
+                            stream->w,
+                            stream->h,
+                            stream->fps);
+        failed   = !write_all(stream->fd, (const uint8_t*) header, (size_t) size);
+
+        SDL_LockMutex(stream->lock);
+        stream->stats.bytes += failed ? 0 : (Uint64) size;
+        stream->stats.failed = failed;
+        SDL_UnlockMutex(stream->lock);
+    }
+
+    SDL_LockMutex(stream->lock);
+    while (true) {
+        while (!stream->quit && stream->queued == 0) {
+            SDL_WaitCondition(stream->wake, stream->lock);
+        }
+        if (stream->queued == 0) {
+            break;
+        }
+
+        void* pixels = stream->buffers[stream->head];
+        SDL_UnlockMutex(stream->lock);
+
+        if (!failed) {
+            if (stream->format == RAYCAST_STREAM_Y4M) {
+                convert_y4m(stream, pixels);
+            } else {
+                convert_rgba(stream, pixels);
+            }
+            failed = !write_all(stream->fd, stream->out, stream->outSize);
+        }
+
+        SDL_LockMutex(stream->lock);
+        if (failed) {
+            stream->stats.failed = true;
+        } else {
+            stream->stats.written++;
+            stream->stats.bytes += stream->outSize;
+        }
+        stream->head = (stream->head + 1) % stream->ringSize;
+        stream->queued--;
+        SDL_BroadcastCondition(stream->done);
+    }
+    SDL_UnlockMutex(stream->lock);
+    return 0;
+}
+
+/**
+ * @brief Create a headless frame stream.
+ *
+ * Frames are rendered with raycast_render_batch() in the pixel format the Raycaster has at
+ * creation and written to fd as raw RGBA (4 bytes per pixel, no header) or as a Y4M video.
+ * The Raycaster must not be modified while raycast_stream_frame() runs, but may be between
+ * frames: queued frames are already rendered. Its pixel format must stay the one the stream
+ * was created with; frames requested while it differs are dropped.
+ *
+ * @param raycaster The Raycaster to render.
+ * @param pool Thread pool to render the columns of a frame with, or NULL.
+ * @param fd File descriptor to write to, such as an open file or a pipe. It stays open.
+ * @param format The output format.
+ * @param w The width of a frame.
+ * @param h The height of a frame.
+ * @param fps Frame rate recorded in the Y4M header.
+ * @param frames Number of frame buffers in the ring (how far rendering may run ahead).
+ * @return The newly allocated stream, or NULL on failure.
+ */
+RaycastStream* raycast_stream_create(Raycaster*          raycaster,
+                                     RaycastThreadPool*  pool,
+                                     int                 fd,
+                                     RaycastStreamFormat format,
+                                     int                 w,
+                                     int                 h,
+                                     int                 fps,
+                                     int                 frames) {
+    if (!raycaster || fd < 0 || w <= 0 || h <= 0 || fps <= 0 || frames <= 0) {
+        return NULL;
+    }
+
+    RaycastStream* stream = (RaycastStream*) calloc(1, sizeof(RaycastStream));
+    if (!stream) {
+        return NULL;
+    }
+
+    stream->raycaster   = raycaster;
+    stream->pool        = pool;
+    stream->fd          = fd;
+    stream->format      = format;
+    stream->pixelFormat = raycaster->pixelFormat;
+    stream->w           = w;
+    stream->h           = h;
+    stream->fps         = fps;
+    stream->ringSize    = frames;
+    stream->outSize     = (size_t) w * h * 4;
+    if (format == RAYCAST_STREAM_Y4M) {
+        stream->outSize = 6 + (size_t) w * h + 2 * (size_t) ((w + 1) / 2) * ((h + 1) / 2);
+    }
+
+    stream->buffers = (void**) calloc(frames, sizeof(void*));
+    stream->out     = (uint8_t*) malloc(stream->outSize);
+    if (!stream->buffers || !stream->out) {
+        raycast_stream_destroy(stream);
+        return NULL;
+    }
+    for (int i = 0; i < frames; i++) {
+        stream->buffers[i] = malloc((size_t) w * h * raycast_pixel_size(stream->pixelFormat));
+        if (!stream->buffers[i]) {
+            raycast_stream_destroy(stream);
+            return NULL;
+        }
+    }
+
+    stream->lock = SDL_CreateMutex();
+    stream->wake = SDL_CreateCondition();
+    stream->done = SDL_CreateCondition();
+    if (!stream->lock || !stream->wake || !stream->done) {
+        raycast_stream_destroy(stream);
+        return NULL;
+    }
+
+    stream->thread = SDL_CreateThread(stream_main, "raycast_stream", stream);
+    if (!stream->thread) {
+        raycast_stream_destroy(stream);
+        return NULL;
+    }
+
+    return stream;
+}
+
+/**
+ * @brief Write out every queued frame, stop the writer and free a stream.
+ *
+ * @param stream The stream to destroy.
+ */
+void raycast_stream_destroy(RaycastStream* stream) {
+    if (!stream) {
+        return;
+    }
+
+    if (stream->thread) {
+        SDL_LockMutex(stream->lock);
+        stream->quit = true;
+        SDL_BroadcastCondition(stream->wake);
+        SDL_UnlockMutex(stream->lock);
+        SDL_WaitThread(stream->thread, NULL);
+    }
+
+    if (stream->buffers) {
+        for (int i = 0; i < stream->ringSize; i++) {
+            free(stream->buffers[i]);
+        }
+    }
+    free(stream->buffers);
+    free(stream->out);
+    SDL_DestroyCondition(stream->done);
+    SDL_DestroyCondition(stream->wake);
+    SDL_DestroyMutex(stream->lock);
+    free(stream);
+}
+
+/**
+ * @brief Render one frame and queue it for writing.
+ *
+ * Never waits for the writer: if every frame buffer is still queued, the frame is dropped
+ * without being rendered. It is dropped as well if the pixel format of the Raycaster no
+ * longer matches the frame buffers.
+ *
+ * @param stream The stream.
+ * @param camera The camera to render the frame from.
+ * @param background The background color of the frame.
+ * @return true if the frame was queued, false if it was dropped.
+ */
+bool raycast_stream_frame(RaycastStream*       stream,
+                          const RaycastCamera* camera,
+                          const RaycastColor*  background) {
+    SDL_LockMutex(stream->lock);
+    if (stream->queued == stream->ringSize
+        || stream->raycaster->pixelFormat != stream->pixelFormat) {
+        stream->stats.dropped++;
+        SDL_UnlockMutex(stream->lock);
+        return false;
+    }
+    // Only the writer frees buffers, so the next free one stays free until it is queued
+    int slot = (stream->head + stream->queued) % stream->ringSize;
+    SDL_UnlockMutex(stream->lock);
+
+    raycast_render_batch(stream->raycaster,
+                         camera,
+                         1,
+                         stream->pool,
+                         stream->buffers[slot],
+                         NULL,
+                         stream->w,
+                         stream->h,
+                         background);
+
+    SDL_LockMutex(stream->lock);
+    stream->queued++;
+    stream->stats.rendered++;
+    SDL_SignalCondition(stream->wake);
+    SDL_UnlockMutex(stream->lock);
+    return true;
+}
+
+/**
+ * @brief Render a scripted camera path, one frame per camera.
+ *
+ * @param stream The stream.
+ * @param path The cameras of consecutive frames.
+ * @param count Number of cameras in path.
+ * @param background The background color of every frame.
+ * @return Number of frames queued; the others were dropped.
+ */
+int raycast_stream_path(RaycastStream*       stream,
+                        const RaycastCamera* path,
+                        int                  count,
+                        const RaycastColor*  background) {
+    int queued = 0;
+    for (int i = 0; i < count; i++) {
+        queued += raycast_stream_frame(stream, &path[i], background) ? 1 : 0;
+    }
+    return queued;
+}
+
+/**
+ * @brief Wait until the writer has written every queued frame.
+ *
+ * @param stream The stream.
+ */
+void raycast_stream_flush(RaycastStream* stream) {
+    SDL_LockMutex(stream->lock);
+    while (stream->queued > 0) {
+        SDL_WaitCondition(stream->done, stream->lock);
+    }
+    SDL_UnlockMutex(stream->lock);
+}
+
+/**
+ * @brief Get the frame counters of a stream.
+ *
+ * @param stream The stream.
+ * @param stats Filled with a snapshot of the counters.
+ */
+void raycast_stream_stats(RaycastStream* stream, RaycastStreamStats* stats) {
+    SDL_LockMutex(stream->lock);
+    *stats = stream->stats;
+    SDL_UnlockMutex(stream->lock);
+}
@@ -0,0 +1,220 @@
+#include "raycast.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * @struct RaycastThreadPool
+ * @brief Persistent worker threads used to run parallel-for jobs.
+ *
+ * @param threads Worker threads (the calling thread is not included)
+ * @param threadCount Number of worker threads
+ * @param lock Protects the job description and the counters below
+ * @param runLock Serializes concurrent calls to raycast_thread_pool_run
+ * @param wake Signalled when a new job is published or the pool is shutting down
+ * @param done Signalled when the last worker finishes the current job
+ * @param task Task function of the current job
+ * @param data User data of the current job
+ * @param taskCount Number of task indices in the current job
+ * @param next Next task index to hand out
+ * @param generation Incremented for every job so sleeping workers can tell jobs apart
+ * @param active Number of workers that have not finished the current job
+ * @param quit Set when the pool is being destroyed
+ */
+struct RaycastThreadPool {
+    SDL_Thread**   threads;
+    int            threadCount;
+    SDL_Mutex*     lock;
+    SDL_Mutex*     runLock;
+    SDL_Condition* wake;
+    SDL_Condition* done;
+    RaycastTask    task;
+    void*          data;
+    int            taskCount;
+    SDL_AtomicInt  next;
+    int            generation;
+    int            active;
+    bool           quit;
+};
+
+/**
+ * @brief Run task indices of the current job until none are left.
+ *
+ * @param pool The thread pool.
+ * @param task Task function of the job.
+ * @param data User data of the job.
+ * @param taskCount Number of task indices in the job.
+ */
+static void drain_tasks(RaycastThreadPool* pool, RaycastTask task, void* data, int taskCount) {
+    int index;
+    while ((index = SDL_AddAtomicInt(&pool->next, 1)) < taskCount) {
+        task(data, index);
+    }
+}
+
+/**
+ * @brief Worker thread entry point.
+ *
+ * @param data The owning thread pool.
+ * @return Always 0.
+ */
+static int worker_main(void* data) {
+    RaycastThreadPool* pool       = (RaycastThreadPool*) data;
+    int                generation = 0;
+
+    SDL_LockMutex(pool->lock);
+    while (true) {
+        while (!pool->quit && pool->generation == generation) {
+            SDL_WaitCondition(pool->wake, pool->lock);
+        }
+        if (pool->quit) {
+            break;
+        }
+
+        RaycastTask task  = pool->task;
+        void*       tdata = pool->data;
+        int         count = pool->taskCount;
+        generation        = pool->generation;
+        SDL_UnlockMutex(pool->lock);
+
+        drain_tasks(pool, task, tdata, count);
+
+        SDL_LockMutex(pool->lock);
+        if (--pool->active == 0) {
+            SDL_SignalCondition(pool->done);
+        }
+    }
+    SDL_UnlockMutex(pool->lock);
+    return 0;
+}
+
+/**
+ * @brief Create a thread pool.
+ *
+ * The calling thread of raycast_thread_pool_run() always takes part in the work, so a pool
+ * created with N threads starts N - 1 workers.
+ *
+ * @param threads Total number of threads to use, or 0 to use one per logical CPU core.
+ * @return The newly allocated thread pool, or NULL on failure.
+ */
+RaycastThreadPool* raycast_thread_pool_create(int threads) {
+    if (threads <= 0) {
+        threads = SDL_GetNumLogicalCPUCores();
+    }
+    if (threads <= 0) {
+        threads = 1;
+    }
+
+    RaycastThreadPool* pool = (RaycastThreadPool*) calloc(1, sizeof(RaycastThreadPool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->lock    = SDL_CreateMutex();
+    pool->runLock = SDL_CreateMutex();
+    pool->wake    = SDL_CreateCondition();
+    pool->done    = SDL_CreateCondition();
+    pool->threads = (SDL_Thread**) calloc(threads, sizeof(SDL_Thread*));
+    if (!pool->lock || !pool->runLock || !pool->wake || !pool->done || !pool->threads) {
+        raycast_thread_pool_destroy(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < threads - 1; i++) {
+        pool->threads[i] = SDL_CreateThread(worker_main, "raycast", pool);
+        if (!pool->threads[i]) {
+            raycast_thread_pool_destroy(pool);
+            return NULL;
+        }
+        pool->threadCount++;
+    }
+
+    return pool;
+}
+
+/**
+ * @brief Stop the workers of a thread pool and free it.
+ *
+ * @param pool The thread pool to destroy.
+ */
+void raycast_thread_pool_destroy(RaycastThreadPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    if (pool->lock) {
+        SDL_LockMutex(pool->lock);
+        pool->quit = true;
+        if (pool->wake) {
+            SDL_BroadcastCondition(pool->wake);
+        }
+        SDL_UnlockMutex(pool->lock);
+    }
+
+    for (int i = 0; i < pool->threadCount; i++) {
+        SDL_WaitThread(pool->threads[i], NULL);
+    }
+
+    free(pool->threads);
+    SDL_DestroyCondition(pool->done);
+    SDL_DestroyCondition(pool->wake);
+    SDL_DestroyMutex(pool->runLock);
+    SDL_DestroyMutex(pool->lock);
+    free(pool);
+}
+
+/**
+ * @brief Get the total number of threads a pool runs jobs on.
+ *
+ * @param pool The thread pool, or NULL.
+ * @return The number of worker threads plus the calling thread, or 1 if pool is NULL.
+ */
+int raycast_thread_pool_size(const RaycastThreadPool* pool) {
+    return pool ? pool->threadCount + 1 : 1;
+}
+
+/**
+ * @brief Run a task for every index in [0, count) and wait for all of them to finish.
+ *
+ * Indices are handed out dynamically, so tasks of uneven cost balance across threads.
+ * If pool is NULL, the tasks run in order on the calling thread.
+ *
+ * @param pool The thread pool, or NULL.
+ * @param task The task function.
+ * @param data User data passed to every task.
+ * @param count Number of task indices.
+ */
+void raycast_thread_pool_run(RaycastThreadPool* pool, RaycastTask task, void* data, int count) {
+    if (count <= 0) {
+        return;
+    }
+
+    if (!pool || pool->threadCount == 0 || count == 1) {
+        for (int i = 0; i < count; i++) {
+            task(data, i);
+        }
+        return;
+    }
+
+    SDL_LockMutex(pool->runLock);
+
+    SDL_LockMutex(pool->lock);
+    pool->task      = task;
+    pool->data      = data;
+    pool->taskCount = count;
+    pool->active    = pool->threadCount;
+    SDL_SetAtomicInt(&pool->next, 0);
+    pool->generation++;
+    SDL_BroadcastCondition(pool->wake);
+    SDL_UnlockMutex(pool->lock);
+
+    drain_tasks(pool, task, data, count);
+
+    SDL_LockMutex(pool->lock);
+    while (pool->active > 0) {
+        SDL_WaitCondition(pool->done, pool->lock);
+    }
+    SDL_UnlockMutex(pool->lock);
+
+    SDL_UnlockMutex(pool->runLock);
+}
@@ -0,0 +1,496 @@
+#include "raycast.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_CELLS     (RAYCAST_PVS_BLOCK * RAYCAST_PVS_BLOCK)
+#define PVS_LINE_BUDGET (BLOCK_CELLS * 4) // Exact lines walked per block pair before keeping it
+
+/**
+ * @struct RaycastVisibility
+ * @brief Potentially visible set of the blocks of a map, for fast line-of-sight queries.
+ *
+ * The map is divided into RAYCAST_PVS_BLOCK x RAYCAST_PVS_BLOCK cell blocks. Block A sees
+ * block B if the center of some open cell of A may have a clear line to the center of some
+ * open cell of B. The set is conservative: a cleared bit proves no cell of A sees any cell of
+ * B, a set bit only means the pair has to be checked exactly.
+ *
+ * @param grid Cached raycast_collides() result of every cell
+ * @param blocksX Number of block columns
+ * @param blocksY Number of block rows
+ * @param blockCount Number of blocks
+ * @param words Number of 64-bit words in one row of the set
+ * @param visible Bit matrix of blockCount rows: bit B of row A is set if A sees B
+ */
+struct RaycastVisibility {
+    RaycastGrid grid;
+    int         blocksX;
+    int         blocksY;
+    int         blockCount;
+    int         words;
+    Uint64*     visible;
+};
+
+/**
+ * @brief Build job shared by all tasks of a set rebuild.
+ *
+ * @param visibility The set being built
+ * @param edits Edited cell rectangles, or NULL to rebuild every pair
+ * @param editCount Number of edited rectangles
+ */
+typedef struct {
+    RaycastVisibility* visibility;
+    const RaycastRect* edits;
+    int                editCount;
+} VisibilityJob;
+
+/**
+ * @brief Rectangle of cells, from the first to one past the last column and row.
+ */
+typedef struct {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+} CellArea;
+
+/**
+ * @brief Check whether a cell blocks sight.
+ *
+ * @param visibility The visibility set.
+ * @param x The x coordinate of the cell.
+ * @param y The y coordinate of the cell.
+ * @return true if the cell is outside the map or solid.
+ */
+static inline bool opaque(const RaycastVisibility* visibility, int x, int y) {
+    const RaycastGrid* grid = &visibility->grid;
+    return x < 0 || x >= grid->width || y < 0 || y >= grid->height
+           || grid->blocked[y * grid->width + x];
+}
+
+/**
+ * @brief Walk the cells crossed by the line between two cell centers.
+ *
+ * Uses exact integer stepping, so the walk from either end visits the same cells. A line
+ * through the exact corner of four cells is blocked only if both side cells are solid.
+ *
+ * @param visibility The visibility set.
+ * @param x0 The x coordinate of the first cell.
+ * @param y0 The y coordinate of the first cell.
+ * @param x1 The x coordinate of the second cell.
+ * @param y1 The y coordinate of the second cell.
+ * @return true if no solid cell lies on the line, including both ends.
+ */
+static bool line_clear(const RaycastVisibility* visibility, int x0, int y0, int x1, int y1) {
+    int dx    = abs(x1 - x0);
+    int dy    = abs(y1 - y0);
+    int sx    = (x1 > x0) ? 1 : -1;
+    int sy    = (y1 > y0) ? 1 : -1;
+    int error = dx - dy;
+    int x     = x0;
+    int y     = y0;
+
+    if (opaque(visibility, x, y)) {
+        return false;
+    }
+
+    dx *= 2;
+    dy *= 2;
+    while (x != x1 || y != y1) {
+        if (error > 0) {
+            x += sx;
+            error -= dy;
+        } else if (error < 0) {
+            y += sy;
+            error += dx;
+        } else {
+            if (opaque(visibility, x + sx, y) && opaque(visibility, x, y + sy)) {
+                return false;
+            }
+            x += sx;
+            y += sy;
+            error += dx - dy;
+        }
+        if (opaque(visibility, x, y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Get the cells of a block.
+ *
+ * @param visibility The visibility set.
+ * @param block Index of the block.
+ * @return The cells of the block, clipped to the map.
+ */
+static CellArea block_area(const RaycastVisibility* visibility, int block) {
+    CellArea area;
+    area.x0 = (block % visibility->blocksX) * RAYCAST_PVS_BLOCK;
+    area.y0 = (block / visibility->blocksX) * RAYCAST_PVS_BLOCK;
+    area.x1 = SDL_min(area.x0 + RAYCAST_PVS_BLOCK, visibility->grid.width);
+    area.y1 = SDL_min(area.y0 + RAYCAST_PVS_BLOCK, visibility->grid.height);
+    return area;
+}
+
+/**
+ * @brief Check whether a block pair has to be recomputed after edits.
+ *
+ * Every line between cell centers of the two blocks lies in the convex hull of their center
+ * rectangles, the block's rectangle swept along the offset between the blocks. Only edits
+ * touching that hull can change the cells a line walks, so the pair is rebuilt only then.
+ *
+ * @param job The build job.
+ * @param a Index of the first block.
+ * @param b Index of the second block.
+ * @return true if the pair is affected by an edit, or every pair is being rebuilt.
+ */
+static bool pair_dirty(const VisibilityJob* job, int a, int b) {
+    if (!job->edits) {
+        return true;
+    }
+
+    int   blocksX = job->visibility->blocksX;
+    float half    = (RAYCAST_PVS_BLOCK - 1) * 0.5f;
+    float centerX = (a % blocksX) * RAYCAST_PVS_BLOCK + RAYCAST_PVS_BLOCK * 0.5f;
+    float centerY = (a / blocksX) * RAYCAST_PVS_BLOCK + RAYCAST_PVS_BLOCK * 0.5f;
+    float dx      = (float) ((b % blocksX - a % blocksX) * RAYCAST_PVS_BLOCK);
+    float dy      = (float) ((b / blocksX - a / blocksX) * RAYCAST_PVS_BLOCK);
+    for (int i = 0; i < job->editCount; i++) {
+        const RaycastRect* edit = &job->edits[i];
+        if (edit->x > centerX + half + SDL_max(dx, 0.0f)
+            || edit->x + edit->w < centerX - half + SDL_min(dx, 0.0f)
+            || edit->y > centerY + half + SDL_max(dy, 0.0f)
+            || edit->y + edit->h < centerY - half + SDL_min(dy, 0.0f)) {
+            continue;
+        }
+
+        // Separating axis across the offset, along which the sweep adds no extent
+        float editX    = edit->x + edit->w * 0.5f - centerX;
+        float editY    = edit->y + edit->h * 0.5f - centerY;
+        float distance = fabsf(editY * dx - editX * dy);
+        float extent   = (half + edit->w * 0.5f) * fabsf(dy) + (half + edit->h * 0.5f) * fabsf(dx);
+        if (distance <= extent) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Mark the cells reachable from a block by monotone steps in one quadrant.
+ *
+ * The cells a clear line walks from (x0, y0) to (x1, y1) form a path of open cells that only
+ * steps towards the end, and that only steps diagonally past a corner if one side is open.
+ * So a cell no such path from the block reaches is not seen from any of its cells.
+ *
+ * @param visibility The visibility set.
+ * @param area Cells to mark, containing the block; reach has one byte per cell of it.
+ * @param block Cells of the block.
+ * @param sx Step along x, 1 or -1.
+ * @param sy Step along y, 1 or -1.
+ * @param bit Bit to set in reach for the quadrant.
+ * @param reach Reachability flags of the cells of area.
+ */
+static void sweep(const RaycastVisibility* visibility,
+                  const CellArea*          area,
+                  const CellArea*          block,
+                  int                      sx,
+                  int                      sy,
+                  uint8_t                  bit,
+                  uint8_t*                 reach) {
+    int width  = area->x1 - area->x0;
+    int startX = (sx > 0) ? block->x0 : block->x1 - 1;
+    int startY = (sy > 0) ? block->y0 : block->y1 - 1;
+    int endX   = (sx > 0) ? area->x1 : area->x0 - 1;
+    int endY   = (sy > 0) ? area->y1 : area->y0 - 1;
+
+    for (int y = startY; y != endY; y += sy) {
+        for (int x = startX; x != endX; x += sx) {
+            if (opaque(visibility, x, y)) {
+                continue;
+            }
+            int  cell    = (y - area->y0) * width + x - area->x0;
+            bool inBlock = x >= block->x0 && x < block->x1 && y >= block->y0 && y < block->y1;
+            bool side    = x != startX && (reach[cell - sx] & bit);
+            bool back    = y != startY && (reach[cell - sy * width] & bit);
+            bool corner  = x != startX && y != startY && (reach[cell - sy * width - sx] & bit)
+                          && !(opaque(visibility, x - sx, y) && opaque(visibility, x, y - sy));
+            if (inBlock || side || back || corner) {
+                reach[cell] |= bit;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Decide whether one block pair sees.
+ *
+ * Cells of B that no monotone path reaches are skipped. The remaining lines are walked
+ * exactly, stopping at the first clear one; after PVS_LINE_BUDGET lines the pair is kept
+ * visible rather than proven hidden.
+ *
+ * @param visibility The visibility set.
+ * @param cellsA x, y pairs of the open cells of A.
+ * @param countA Number of open cells of A.
+ * @param b Index of the second block.
+ * @param area Cells covered by reach.
+ * @param reach Reachability flags from A, or NULL if unavailable.
+ * @return true if some cell of A may see some cell of B.
+ */
+static bool pair_sees(const RaycastVisibility* visibility,
+                      const int*               cellsA,
+                      int                      countA,
+                      int                      b,
+                      const CellArea*          area,
+                      const uint8_t*           reach) {
+    int      cellsB[BLOCK_CELLS * 2];
+    int      countB = 0;
+    CellArea cells  = block_area(visibility, b);
+    for (int y = cells.y0; y < cells.y1; y++) {
+        for (int x = cells.x0; x < cells.x1; x++) {
+            if (!opaque(visibility, x, y)
+                && (!reach || reach[(y - area->y0) * (area->x1 - area->x0) + x - area->x0])) {
+                cellsB[countB * 2]     = x;
+                cellsB[countB * 2 + 1] = y;
+                countB++;
+            }
+        }
+    }
+
+    int lines = 0;
+    for (int i = 0; i < countA; i++) {
+        for (int j = 0; j < countB; j++) {
+            if (line_clear(visibility,
+                           cellsA[i * 2],
+                           cellsA[i * 2 + 1],
+                           cellsB[j * 2],
+                           cellsB[j * 2 + 1])
+                || ++lines >= PVS_LINE_BUDGET) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Recompute the pairs of one block with every block of equal or higher index.
+ *
+ * Only row a of the set is written, so rows are built in parallel without locking.
+ *
+ * @param data The VisibilityJob.
+ * @param a Index of the block.
+ */
+static void build_row(void* data, int a) {
+    VisibilityJob*     job        = (VisibilityJob*) data;
+    RaycastVisibility* visibility = job->visibility;
+    Uint64*            row        = visibility->visible + (size_t) a * visibility->words;
+    CellArea           block      = block_area(visibility, a);
+    CellArea           area       = block;
+    int                cellsA[BLOCK_CELLS * 2];
+    int                countA = 0;
+    bool               dirty  = false;
+
+    for (int b = a; b < visibility->blockCount; b++) {
+        if (pair_dirty(job, a, b)) {
+            CellArea cells = block_area(visibility, b);
+            area.x0        = SDL_min(area.x0, cells.x0);
+            area.x1        = SDL_max(area.x1, cells.x1);
+            area.y1        = SDL_max(area.y1, cells.y1);
+            dirty          = true;
+        }
+    }
+    if (!dirty) {
+        return;
+    }
+
+    for (int y = block.y0; y < block.y1; y++) {
+        for (int x = block.x0; x < block.x1; x++) {
+            if (!opaque(visibility, x, y)) {
+                cellsA[countA * 2]     = x;
+                cellsA[countA * 2 + 1] = y;
+                countA++;
+            }
+        }
+    }
+
+    // Without memory for the sweeps every dirty pair is walked exactly, within the budget
+    uint8_t* reach = NULL;
+    if (countA > 0) {
+        reach = (uint8_t*) calloc((size_t) (area.x1 - area.x0) * (area.y1 - area.y0), 1);
+    }
+    if (reach) {
+        sweep(visibility, &area, &block, 1, 1, 1, reach);
+        sweep(visibility, &area, &block, -1, 1, 2, reach);
+        sweep(visibility, &area, &block, 1, -1, 4, reach);
+        sweep(visibility, &area, &block, -1, -1, 8, reach);
+    }
+
+    for (int b = a; b < visibility->blockCount; b++) {
+        if (!pair_dirty(job, a, b)) {
+            continue;
+        }
+
+        if (countA > 0 && pair_sees(visibility, cellsA, countA, b, &area, reach)) {
+            row[b / 64] |= (Uint64) 1 << (b % 64);
+        } else {
+            row[b / 64] &= ~((Uint64) 1 << (b % 64));
+        }
+    }
+    free(reach);
+}
+
+/**
+ * @brief Rebuild the affected pairs of the set and mirror them into the lower triangle.
+ *
+ * @param visibility The visibility set.
+ * @param edits Edited areas in blocks, or NULL to rebuild every pair.
+ * @param editCount Number of edited areas.
+ * @param pool Thread pool to build with, or NULL.
+ */
+static void build(RaycastVisibility* visibility,
+                  const RaycastRect* edits,
+                  int                editCount,
+                  RaycastThreadPool* pool) {
+    VisibilityJob job = { .visibility = visibility, .edits = edits, .editCount = editCount };
+    raycast_thread_pool_run(pool, build_row, &job, visibility->blockCount);
+
+    for (int a = 0; a < visibility->blockCount; a++) {
+        const Uint64* row = visibility->visible + (size_t) a * visibility->words;
+        for (int b = a + 1; b < visibility->blockCount; b++) {
+            Uint64* mirror = visibility->visible + (size_t) b * visibility->words + a / 64;
+            if ((row[b / 64] >> (b % 64)) & 1) {
+                *mirror |= (Uint64) 1 << (a % 64);
+            } else {
+                *mirror &= ~((Uint64) 1 << (a % 64));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Create the potentially visible set of a map.
+ *
+ * @param raycaster The Raycaster whose map to describe.
+ * @param pool Thread pool to build the set with, or NULL.
+ * @return The newly allocated visibility set, or NULL on failure.
+ */
+RaycastVisibility* raycast_visibility_create(Raycaster* raycaster, RaycastThreadPool* pool) {
+    if (!raycaster) {
+        return NULL;
+    }
+
+    RaycastVisibility* visibility = (RaycastVisibility*) calloc(1, sizeof(RaycastVisibility));
+    if (!visibility) {
+        return NULL;
+    }
+
+    visibility->grid.raycaster = raycaster;
+    if (raycast_visibility_update(visibility, pool)) {
+        raycast_visibility_destroy(visibility);
+        return NULL;
+    }
+
+    return visibility;
+}
+
+/**
+ * @brief Free a visibility set.
+ *
+ * @param visibility The visibility set to destroy.
+ */
+void raycast_visibility_destroy(RaycastVisibility* visibility) {
+    if (!visibility) {
+        return;
+    }
+
+    free(visibility->visible);
+    raycast_grid_free(&visibility->grid);
+    free(visibility);
+}
+
+/**
+ * @brief Bring a visibility set up to date with edits to its map.
+ *
+ * Only block pairs with a sightline that can cross an edit reported by the edit journal are
+ * recomputed; the whole set is rebuilt if the journal overflowed or the map was
+ * re-initialized. Must not run concurrently with raycast_line_of_sight().
+ *
+ * @param visibility The visibility set.
+ * @param pool Thread pool to rebuild with, or NULL.
+ * @return 0 on success, 1 on allocation failure.
+ */
+int raycast_visibility_update(RaycastVisibility* visibility, RaycastThreadPool* pool) {
+    RaycastGrid* grid = &visibility->grid;
+    RaycastRect  edits[RAYCAST_EDIT_JOURNAL];
+    int          count;
+
+    if (raycast_grid_sync(grid, edits, &count)) {
+        return 1;
+    }
+
+    if (visibility->visible && count >= 0) {
+        if (count > 0) {
+            build(visibility, edits, count, pool);
+        }
+        return 0;
+    }
+
+    int    blocksX = (grid->width + RAYCAST_PVS_BLOCK - 1) / RAYCAST_PVS_BLOCK;
+    int    blocksY = (grid->height + RAYCAST_PVS_BLOCK - 1) / RAYCAST_PVS_BLOCK;
+    int    words   = (blocksX * blocksY + 63) / 64;
+    size_t bits    = (size_t) blocksX * blocksY * words * sizeof(Uint64);
+    if (!visibility->visible || visibility->blocksX != blocksX || visibility->blocksY != blocksY) {
+        Uint64* visible = (Uint64*) malloc(bits);
+        if (!visible) {
+            // Drop the grid too, so no query indexes the old set with the new map size
+            free(visibility->visible);
+            visibility->visible = NULL;
+            raycast_grid_free(grid);
+            return 1;
+        }
+        free(visibility->visible);
+        visibility->visible    = visible;
+        visibility->blocksX    = blocksX;
+        visibility->blocksY    = blocksY;
+        visibility->blockCount = blocksX * blocksY;
+        visibility->words      = words;
+    }
+
+    memset(visibility->visible, 0, bits);
+    build(visibility, NULL, 0, pool);
+    return 0;
+}
+
+/**
+ * @brief Check whether the centers of two cells can see each other.
+ *
+ * Pairs of cells whose blocks cannot see each other are rejected from the potentially
+ * visible set; the remaining candidates are checked exactly by walking the cells on the line.
+ * Answers reflect the map as of the last raycast_visibility_update(). Safe to call from many
+ * threads at once.
+ *
+ * @param visibility The visibility set.
+ * @param x0 The x coordinate of the first cell.
+ * @param y0 The y coordinate of the first cell.
+ * @param x1 The x coordinate of the second cell.
+ * @param y1 The y coordinate of the second cell.
+ * @return true if both cells are open and no solid cell lies between their centers.
+ */
+bool raycast_line_of_sight(const RaycastVisibility* visibility, int x0, int y0, int x1, int y1) {
+    if (opaque(visibility, x0, y0) || opaque(visibility, x1, y1)) {
+        return false;
+    }
+
+    int a = (y0 / RAYCAST_PVS_BLOCK) * visibility->blocksX + x0 / RAYCAST_PVS_BLOCK;
+    int b = (y1 / RAYCAST_PVS_BLOCK) * visibility->blocksX + x1 / RAYCAST_PVS_BLOCK;
+    if (!((visibility->visible[(size_t) a * visibility->words + b / 64] >> (b % 64)) & 1)) {
+        return false;
+    }
+
+    return line_clear(visibility, x0, y0, x1, y1);
+}
@@ -2,7 +2,14 @@
 
 #include "raycast/raycast.h"
 
+#include <dirent.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #define INIT(w, h) raycaster = raycast_init(w, h)
 
@@ -11,12 +18,7 @@ Raycaster* raycaster = NULL;
 void       setUp(void) {}
 
 void       tearDown(void) {
-    if (raycaster) {
-        if (raycaster->map) {
-            free(raycaster->map);
-        }
-        free(raycaster);
-    }
+    raycast_destroy(raycaster);
     raycaster = NULL;
 }
 
@@ -58,3 +60,1347 @@ void test_raycast_erase(void) {
         }
     }
 }
+
+void test_raycast_render_batch(void) {
+    INIT(16, 16);
+    RaycastRect  all   = { 0, 0, 16, 16 };
+    RaycastRect  inner = { 1, 1, 14, 14 };
+    RaycastColor wall  = 0xFF00FF00;
+    RaycastColor bg    = 0xFF000000;
+    int          w     = 40;
+    int          h     = 30;
+    int          count = 3;
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+
+    RaycastCamera      cameras[3] = { { 8.0f, 8.0f, 1.0f, 0.0f, 0.0f, 0.66f, 90 },
+                                      { 4.5f, 3.5f, 0.0f, 1.0f, 0.0f, 0.66f, 60 },
+                                      { 12.0f, 10.0f, -1.0f, 0.0f, 0.0f, 0.66f, 90 } };
+
+    RaycastThreadPool* pool       = raycast_thread_pool_create(4);
+    RaycastColor*      frames     = (RaycastColor*) malloc(count * w * h * sizeof(RaycastColor));
+    float*             depth      = (float*) malloc(count * w * h * sizeof(float));
+    RaycastColor*      single     = (RaycastColor*) malloc(w * h * sizeof(RaycastColor));
+    float*             sdepth     = (float*) malloc(w * h * sizeof(float));
+    TEST_ASSERT_NOT_NULL(pool);
+
+    raycast_render_batch(raycaster, cameras, count, pool, frames, depth, w, h, &bg);
+    for (int i = 0; i < count; i++) {
+        raycast_render_buffer(raycaster, &cameras[i], single, sdepth, w, h, &bg);
+        TEST_ASSERT_EQUAL_MEMORY(single, frames + i * w * h, w * h * sizeof(RaycastColor));
+        TEST_ASSERT_EQUAL_MEMORY(sdepth, depth + i * w * h, w * h * sizeof(float));
+    }
+    TEST_ASSERT_EQUAL_INT(wall, frames[(h / 2) * w + w / 2]);
+    TEST_ASSERT_EQUAL_INT(bg, frames[w / 2]);
+
+    raycast_thread_pool_destroy(pool);
+    free(frames);
+    free(depth);
+    free(single);
+    free(sdepth);
+}
+
+void test_raycast_render_gbuffer(void) {
+    INIT(16, 16);
+    RaycastRect  all   = { 0, 0, 16, 16 };
+    RaycastRect  inner = { 1, 1, 14, 14 };
+    RaycastColor wall  = 0xFF00FF00;
+    RaycastColor bg    = 0xFF000000;
+    int          w     = 8;
+    int          h     = 8;
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+
+    RaycastCamera  camera = { 8.0f, 8.5f, 1.0f, 0.0f, 0.0f, 0.66f, 90 };
+    RaycastColor   pixels[8 * 8];
+    float          distance[8];
+    int            cell[8];
+    int            textureId[8];
+    uint8_t        side[8];
+    float          wallX[8];
+    RaycastGBuffer gbuffer = { distance, cell, textureId, side, wallX };
+
+    raycast_render_buffer_gbuffer(raycaster, &camera, pixels, NULL, w, h, &bg, &gbuffer);
+
+    // The middle column looks straight down the x axis at the east wall
+    TEST_ASSERT_EQUAL_INT(8 * 16 + 15, cell[w / 2]);
+    TEST_ASSERT_EQUAL_INT(wall, textureId[w / 2]);
+    TEST_ASSERT_EQUAL_INT(0, side[w / 2]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 7.0f, distance[w / 2]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, wallX[w / 2]);
+    for (int x = 0; x < w; x++) {
+        RaycastHit hit;
+        float      angle = -(camera.fov / 2.0f) + (camera.fov * x) / w;
+        raycast_cast_textured(raycaster, camera.posX, camera.posY, angle, &hit);
+        TEST_ASSERT_EQUAL_INT(hit.cell, cell[x]);
+        TEST_ASSERT_EQUAL_FLOAT(hit.distance, distance[x]);
+    }
+}
+
+void test_raycast_max_distance(void) {
+    INIT(16, 16);
+    RaycastRect   all   = { 0, 0, 16, 16 };
+    RaycastRect   inner = { 1, 1, 14, 14 };
+    RaycastColor  wall  = 0xFF00FF00;
+    RaycastColor  bg    = 0xFF000000;
+    RaycastColor  color = RAYCAST_EMPTY;
+    RaycastColor  pixels[4 * 40];
+    int           cell[4];
+    RaycastCamera camera = { 8.0f, 8.5f, 1.0f, 0.0f, 0.0f, 0.66f, 90 };
+    RaycastHit    hit;
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+
+    raycaster->maxDistance = 5.0f;
+    raycast_cast_textured(raycaster, camera.posX, camera.posY, 0.0f, &hit);
+    TEST_ASSERT_EQUAL_INT(-1, hit.cell);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, raycast_cast(raycaster, camera.posX, camera.posY, 0.0f, &color));
+
+    // A wall inside the view distance is faded toward the fog color
+    raycaster->maxDistance = 14.0f;
+    raycaster->fogColor    = 0xFFFFFFFF;
+    RaycastGBuffer gbuffer = { NULL, cell, NULL, NULL, NULL };
+    raycast_render_buffer_gbuffer(raycaster, &camera, pixels, NULL, 4, 40, &bg, &gbuffer);
+    TEST_ASSERT_EQUAL_INT(8 * 16 + 15, cell[2]);
+    TEST_ASSERT_EQUAL_HEX32(0xFF7FFF7F, pixels[20 * 4 + 2]);
+}
+
+void test_raycast_compact_map(void) {
+    RaycastColor    wall      = 0xFF00FF00;
+    RaycastColor    bg        = 0xFF000000;
+    RaycastRect     all       = { 0, 0, 16, 16 };
+    RaycastRect     inner     = { 1, 1, 14, 14 };
+    RaycastRect     pillar    = { 6, 6, 2, 2 };
+    RaycastCellType wallType  = { wall, -1, 1 };
+    RaycastCellType ghostType = { 0xFFFF0000, -1, 0 };
+    RaycastCamera   camera    = { 3.5f, 4.5f, 1.0f, 0.3f, 0.0f, 0.66f, 90 };
+    RaycastColor    expected[32 * 24];
+    RaycastColor    actual[32 * 24];
+
+    INIT(16, 16);
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+    raycast_draw(raycaster, &pillar, &ghostType.color);
+    raycast_render_buffer(raycaster, &camera, expected, NULL, 32, 24, &bg);
+    raycast_destroy(raycaster);
+
+    for (int bits = 8; bits <= 16; bits += 8) {
+        raycaster = raycast_init_compact(16, 16, bits);
+        TEST_ASSERT_NOT_NULL(raycaster);
+        RaycastColor wallId  = raycast_add_cell_type(raycaster, &wallType);
+        RaycastColor ghostId = raycast_add_cell_type(raycaster, &ghostType);
+        TEST_ASSERT_EQUAL_INT(1, wallId);
+        TEST_ASSERT_EQUAL_INT(2, ghostId);
+
+        raycast_draw(raycaster, &all, &wallId);
+        raycast_erase(raycaster, &inner);
+        raycast_draw(raycaster, &pillar, &ghostId);
+        TEST_ASSERT_EQUAL_INT(RAYCAST_CELL_EMPTY, raycast_get_cell(raycaster, 5, 5));
+        TEST_ASSERT_EQUAL_INT(ghostId, raycast_get_cell(raycaster, 7, 7));
+        TEST_ASSERT_TRUE(raycast_collides(raycaster, 0.5f, 0.5f));
+        TEST_ASSERT_FALSE(raycast_collides(raycaster, 7.5f, 7.5f));
+
+        // IDs without a cell type are refused instead of being stored or truncated
+        RaycastColor unknown  = 3;
+        RaycastColor oversize = 0x103;
+        TEST_ASSERT_EQUAL_INT(1, raycast_draw(raycaster, &pillar, &unknown));
+        TEST_ASSERT_EQUAL_INT(1, raycast_draw(raycaster, &pillar, &oversize));
+        TEST_ASSERT_EQUAL_INT(1, raycast_draw(raycaster, &pillar, &wall));
+        TEST_ASSERT_EQUAL_INT(ghostId, raycast_get_cell(raycaster, 7, 7));
+
+        raycast_render_buffer(raycaster, &camera, actual, NULL, 32, 24, &bg);
+        TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+        raycast_destroy(raycaster);
+        raycaster = NULL;
+    }
+}
+
+void test_raycast_indexed_texture(void) {
+    RaycastColor    bg     = 0xFF000000;
+    RaycastRect     all    = { 0, 0, 16, 16 };
+    RaycastRect     inner  = { 1, 1, 14, 14 };
+    RaycastColor    id     = 0;
+    RaycastCamera   camera = { 5.5f, 6.5f, 1.0f, 0.4f, 0.0f, 0.66f, 90 };
+    RaycastTexture* argb   = raycast_texture_create(8, 8);
+    RaycastColor    expected[32 * 24];
+    RaycastColor    actual[32 * 24];
+    RaycastColor    clear[32 * 24];
+    for (int i = 0; i < 64; i++) {
+        argb->pixels[i] = (i % 3 == 0) ? 0xFFFF0000 : (i % 3 == 1) ? 0xFF00FF00 : 0xFF2040F0;
+    }
+
+    RaycastTexture* indexed = raycast_texture_to_indexed(argb, NULL);
+    TEST_ASSERT_NOT_NULL(indexed);
+    TEST_ASSERT_NULL(indexed->pixels);
+    for (int i = 0; i < 64; i++) {
+        TEST_ASSERT_EQUAL_HEX32(argb->pixels[i], indexed->palette->colors[indexed->indices[i]]);
+    }
+    TEST_ASSERT_NULL(raycast_texture_create_indexed(-8, 8, indexed->palette));
+    TEST_ASSERT_NULL(raycast_texture_create_indexed(65536, 65536, indexed->palette));
+
+    INIT(16, 16);
+    raycast_draw(raycaster, &all, &id);
+    raycast_erase(raycaster, &inner);
+    raycast_add_texture(raycaster, argb);
+    raycast_render_buffer(raycaster, &camera, expected, NULL, 32, 24, &bg);
+
+    // Swap in the indexed texture: per-pixel palette lookup, then precomputed shades
+    raycaster->textures[0] = indexed;
+    raycast_render_buffer(raycaster, &camera, actual, NULL, 32, 24, &bg);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+    TEST_ASSERT_EQUAL_INT(0, raycast_palette_build_shades(indexed->palette, raycaster->fogColor));
+    raycast_render_buffer(raycaster, &camera, actual, NULL, 32, 24, &bg);
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+
+    // With fog the shades quantize the fog amount, so channels only stay close to ARGB
+    memcpy(clear, expected, sizeof(clear));
+    raycaster->maxDistance = 20.0f;
+    raycaster->fogColor    = 0xFF808080;
+    raycaster->textures[0] = argb;
+    raycast_render_buffer(raycaster, &camera, expected, NULL, 32, 24, &bg);
+    TEST_ASSERT_TRUE(memcmp(clear, expected, sizeof(clear)) != 0);
+    raycaster->textures[0] = indexed;
+    for (int shaded = 0; shaded < 2; shaded++) {
+        if (shaded) {
+            TEST_ASSERT_EQUAL_INT(
+                0,
+                raycast_palette_build_shades(indexed->palette, raycaster->fogColor));
+        }
+        raycast_render_buffer(raycaster, &camera, actual, NULL, 32, 24, &bg);
+        for (int i = 0; i < 32 * 24; i++) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                TEST_ASSERT_FLOAT_WITHIN(5.0f,
+                                         (float) ((expected[i] >> shift) & 0xFF),
+                                         (float) ((actual[i] >> shift) & 0xFF));
+            }
+        }
+    }
+
+    raycast_texture_destroy(argb);
+}
+
+void test_raycast_wall_spans(void) {
+    RaycastColor    bg      = 0xFF000000;
+    RaycastRect     all     = { 0, 0, 16, 16 };
+    RaycastRect     inner   = { 1, 1, 14, 14 };
+    RaycastColor    id      = 0;
+    RaycastCamera   camera  = { 14.3f, 8.5f, 1.0f, 0.2f, 0.0f, 0.66f, 90 };
+    RaycastTexture* texture = raycast_texture_create(4, 7);
+    RaycastColor    pixels[8 * 60];
+    for (int i = 0; i < 4 * 7; i++) {
+        // Rows 2 and 3 share a color so their runs merge
+        int row            = i / 4;
+        texture->pixels[i] = 0xFF000000 | (uint32_t) ((row == 3) ? 2 : row) * 0x102030;
+    }
+
+    INIT(16, 16);
+    raycast_draw(raycaster, &all, &id);
+    raycast_erase(raycaster, &inner);
+    raycast_add_texture(raycaster, texture);
+    raycast_render_buffer(raycaster, &camera, pixels, NULL, 8, 60, &bg);
+
+    // Every pixel matches a per-pixel walk of the magnified and clipped wall
+    float direction = atan2f(camera.dirY, camera.dirX) * (180.0f / M_PI);
+    for (int x = 0; x < 8; x++) {
+        RaycastHit hit;
+        float      angle = direction - (camera.fov / 2.0f) + (camera.fov * x) / 8;
+        raycast_cast_textured(raycaster, camera.posX, camera.posY, angle, &hit);
+        int wallHeight = (int) (60 / (hit.distance + 0.0001f));
+        int wallTop    = (60 - wallHeight) / 2;
+        int texX       = (int) (hit.wallX * 4);
+        TEST_ASSERT_TRUE(wallHeight > 60);
+        for (int y = 0; y < 60; y++) {
+            int texY = (int) ((float) (y - wallTop) / (float) wallHeight * 7);
+            TEST_ASSERT_EQUAL_HEX32(texture->pixels[texY * 4 + texX], pixels[y * 8 + x]);
+        }
+    }
+}
+
+void test_raycast_arena(void) {
+    RaycastArena* arena = raycast_arena_create(64 * 1024);
+    TEST_ASSERT_NOT_NULL(arena);
+
+    raycaster = raycast_init_arena(arena, 16, 16, 32, 2);
+    TEST_ASSERT_NOT_NULL(raycaster);
+    TEST_ASSERT_EQUAL_INT(RAYCAST_EMPTY, raycast_get_cell(raycaster, 3, 3));
+
+    // Growing past the reserved capacity keeps the textures in order
+    for (int i = 0; i < 5; i++) {
+        RaycastTexture* texture = raycast_texture_create_arena(arena, 8, 8);
+        TEST_ASSERT_NOT_NULL(texture);
+        TEST_ASSERT_EQUAL_INT(0, (uintptr_t) texture->pixels % RAYCAST_ARENA_ALIGNMENT);
+        TEST_ASSERT_EQUAL_INT(0, texture->pixels[63]);
+        texture->pixels[0] = i;
+        raycast_add_texture(raycaster, texture);
+    }
+    TEST_ASSERT_EQUAL_INT(5, raycaster->textureCount);
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_INT(i, raycaster->textures[i]->pixels[0]);
+    }
+
+    // A texture whose pixels do not fit leaves the arena as it was
+    size_t used = arena->used;
+    TEST_ASSERT_NULL(raycast_texture_create_arena(arena, 1024, 1024));
+    TEST_ASSERT_TRUE(arena->used == used);
+    TEST_ASSERT_NULL(raycast_texture_create_arena(arena, 0, 8));
+    TEST_ASSERT_TRUE(arena->used == used);
+
+    // So does a Raycaster that does not fit, whichever of its allocations fails
+    TEST_ASSERT_NULL(raycast_init_arena(arena, 1024, 1024, 32, 0));
+    TEST_ASSERT_TRUE(arena->used == used);
+    TEST_ASSERT_NULL(raycast_init_arena(arena, 8, 8, 8, 1 << 20));
+    TEST_ASSERT_TRUE(arena->used == used);
+    TEST_ASSERT_NULL(raycast_init_arena(arena, 65536, 65536, 8, 0));
+    TEST_ASSERT_NULL(raycast_init_arena(arena, -16, 16, 32, 0));
+    TEST_ASSERT_TRUE(arena->used == used);
+
+    // Destroying an arena-backed Raycaster frees nothing; the arena owns the memory
+    raycast_destroy(raycaster);
+    raycaster = NULL;
+    raycast_arena_reset(arena);
+    TEST_ASSERT_EQUAL_INT(0, arena->used);
+    raycast_arena_destroy(arena);
+}
+
+void test_raycast_texture_load(void) {
+    const char* paths[2] = { "test_texture.ppm", "test_texture.pam" };
+    const char  ppm[]    = "P6\n# comment\n2 1\n255\n\xff\x00\x00\x00\x80\xff";
+    const char  pam[]    = "P7\nWIDTH 1\nHEIGHT 2\nDEPTH 2\nMAXVAL 255\nTUPLTYPE GRAYSCALE_ALPHA\n"
+                           "ENDHDR\n\x40\xff\xc0\x00";
+    FILE*       file     = fopen(paths[0], "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    fwrite(ppm, 1, sizeof(ppm) - 1, file);
+    fclose(file);
+    file = fopen(paths[1], "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    fwrite(pam, 1, sizeof(pam) - 1, file);
+    fclose(file);
+
+    // Cache entries are named after the FNV-1a hash of the file contents
+    const char* cacheDir   = "test_texture_cache";
+    const char* sources[2] = { ppm, pam };
+    size_t      sizes[2]   = { sizeof(ppm) - 1, sizeof(pam) - 1 };
+    char        entries[2][256];
+    TEST_ASSERT_TRUE(mkdir(cacheDir, 0755) == 0 || errno == EEXIST);
+    for (int i = 0; i < 2; i++) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t j = 0; j < sizes[i]; j++) {
+            hash = (hash ^ (uint8_t) sources[i][j]) * 0x100000001b3ull;
+        }
+        snprintf(entries[i],
+                 sizeof(entries[i]),
+                 "%s/%08x%08x.rctx",
+                 cacheDir,
+                 (unsigned) (hash >> 32),
+                 (unsigned) (hash & 0xFFFFFFFFu));
+        remove(entries[i]);
+    }
+
+    // The second round is served from the cache: a tampered entry shows up in the texture
+    RaycastThreadPool* pool = raycast_thread_pool_create(2);
+    for (int round = 0; round < 2; round++) {
+        RaycastTexture* textures[2];
+        TEST_ASSERT_EQUAL_INT(0, raycast_texture_load_set(paths, 2, textures, pool, cacheDir));
+        TEST_ASSERT_EQUAL_INT(2, textures[0]->width);
+        TEST_ASSERT_EQUAL_INT(1, textures[0]->height);
+        TEST_ASSERT_EQUAL_HEX32(round ? 0xFF123456 : 0xFFFF0000, textures[0]->pixels[0]);
+        TEST_ASSERT_EQUAL_HEX32(0xFF0080FF, textures[0]->pixels[1]);
+        TEST_ASSERT_EQUAL_INT(1, textures[1]->width);
+        TEST_ASSERT_EQUAL_INT(2, textures[1]->height);
+        TEST_ASSERT_EQUAL_HEX32(0xFF404040, textures[1]->pixels[0]);
+        TEST_ASSERT_EQUAL_HEX32(0x00C0C0C0, textures[1]->pixels[1]);
+        raycast_texture_destroy(textures[0]);
+        raycast_texture_destroy(textures[1]);
+
+        RaycastColor tampered = 0xFF123456;
+        file                  = fopen(entries[0], "r+b");
+        TEST_ASSERT_NOT_NULL(file);
+        TEST_ASSERT_EQUAL_INT(0, fseek(file, 4 + 3 * sizeof(int32_t), SEEK_SET));
+        TEST_ASSERT_EQUAL_INT(1, fwrite(&tampered, sizeof(tampered), 1, file));
+        fclose(file);
+    }
+    raycast_thread_pool_destroy(pool);
+
+    // Only the two entries are left behind, no temporary files
+    DIR*           dir   = opendir(cacheDir);
+    int            count = 0;
+    struct dirent* item;
+    TEST_ASSERT_NOT_NULL(dir);
+    while ((item = readdir(dir))) {
+        count += item->d_name[0] != '.';
+    }
+    closedir(dir);
+    TEST_ASSERT_EQUAL_INT(2, count);
+    TEST_ASSERT_EQUAL_INT(0, remove(entries[0]));
+    TEST_ASSERT_EQUAL_INT(0, remove(entries[1]));
+    TEST_ASSERT_EQUAL_INT(0, rmdir(cacheDir));
+
+    TEST_ASSERT_NULL(raycast_texture_load("does_not_exist.ppm", NULL));
+
+    // Dimensions beyond the texture limit or the data in the file are rejected before allocating
+    const char* bad[3] = { "P3\n65536 65537\n255\n0 0 0\n",
+                           "P2\n4 4\n255\n1 2 3\n",
+                           "P6\n2 2\n255\n\xff\x10\x20" };
+    for (int i = 0; i < 3; i++) {
+        file = fopen(paths[0], "wb");
+        TEST_ASSERT_NOT_NULL(file);
+        fputs(bad[i], file);
+        fclose(file);
+        TEST_ASSERT_NULL(raycast_texture_load(paths[0], NULL));
+    }
+    TEST_ASSERT_NULL(raycast_texture_create(65536, 65537));
+
+    remove(paths[0]);
+    remove(paths[1]);
+}
+
+void test_raycast_pipeline(void) {
+    RaycastColor         wall     = 0xFF00FF00;
+    RaycastColor         bg       = 0xFF000000;
+    RaycastRect          all      = { 0, 0, 16, 16 };
+    RaycastRect          inner    = { 1, 1, 14, 14 };
+    RaycastCamera        camera   = { 3.5f, 8.5f, 1.0f, 0.0f, 0.0f, 0.66f, 90 };
+    SDL_Surface*         surface  = SDL_CreateSurface(32, 24, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer*        renderer = SDL_CreateSoftwareRenderer(surface);
+    RaycastPipelineStats stats;
+    TEST_ASSERT_NOT_NULL(renderer);
+
+    INIT(16, 16);
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+    RaycastPipeline* pipeline = raycast_pipeline_create(raycaster, renderer, NULL, 32, 24);
+    TEST_ASSERT_NOT_NULL(pipeline);
+
+    // Nothing submitted yet, so there is nothing to wait for
+    TEST_ASSERT_FALSE(raycast_pipeline_draw(pipeline));
+    for (int i = 0; i < 3; i++) {
+        camera.posX += 1.0f;
+        raycast_pipeline_submit(pipeline, &camera, &bg, SDL_GetTicksNS());
+        TEST_ASSERT_TRUE(raycast_pipeline_draw(pipeline));
+        raycast_pipeline_present(pipeline);
+    }
+    TEST_ASSERT_FALSE(raycast_pipeline_draw(pipeline));
+
+    // A burst of submissions collapses to the newest frame
+    for (int i = 0; i < 4; i++) {
+        raycast_pipeline_submit(pipeline, &camera, &bg, SDL_GetTicksNS());
+    }
+    raycast_pipeline_wait(pipeline);
+    TEST_ASSERT_TRUE(raycast_pipeline_draw(pipeline));
+    raycast_pipeline_present(pipeline);
+
+    raycast_pipeline_stats(pipeline, &stats);
+    TEST_ASSERT_EQUAL_INT(7, stats.submitted);
+    TEST_ASSERT_EQUAL_INT(stats.submitted, stats.rendered + stats.skipped);
+    TEST_ASSERT_EQUAL_INT(stats.rendered, stats.presented + stats.dropped);
+    TEST_ASSERT_EQUAL_INT(4, stats.presented);
+    TEST_ASSERT_TRUE(stats.maxLatency >= stats.averageLatency);
+
+    // Frames are dropped while the Raycaster renders in another pixel format than the buffers
+    raycaster->pixelFormat = RAYCAST_PIXEL_ABGR8888;
+    raycast_pipeline_submit(pipeline, &camera, &bg, SDL_GetTicksNS());
+    raycast_pipeline_wait(pipeline);
+    TEST_ASSERT_FALSE(raycast_pipeline_draw(pipeline));
+    raycaster->pixelFormat = RAYCAST_PIXEL_ARGB8888;
+    raycast_pipeline_stats(pipeline, &stats);
+    TEST_ASSERT_EQUAL_INT(8, stats.submitted);
+    TEST_ASSERT_EQUAL_INT(stats.submitted, stats.rendered + stats.skipped + 1);
+    TEST_ASSERT_EQUAL_INT(stats.rendered + 1, stats.presented + stats.dropped);
+
+    raycast_pipeline_destroy(pipeline);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroySurface(surface);
+}
+
+void test_raycast_snapshots(void) {
+    RaycastColor  wall   = 0xFF00FF00;
+    RaycastColor  other  = 0xFFFF0000;
+    RaycastColor  bg     = 0xFF000000;
+    RaycastRect   all    = { 0, 0, 16, 40 };
+    RaycastRect   inner  = { 1, 1, 14, 38 };
+    RaycastRect   pillar = { 6, 20, 2, 2 };
+    RaycastCamera camera = { 2.5f, 21.0f, 1.0f, 0.0f, 0.0f, 0.66f, 90 };
+    RaycastRect   edits[RAYCAST_EDIT_JOURNAL];
+    RaycastColor  before[32 * 24];
+    RaycastColor  after[32 * 24];
+    RaycastColor  actual[32 * 24];
+
+    INIT(16, 40);
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+    raycast_render_buffer(raycaster, &camera, before, NULL, 32, 24, &bg);
+
+    Uint64            revision  = raycaster->revision;
+    RaycastSnapshots* snapshots = raycast_snapshots_create(raycaster, 2);
+    TEST_ASSERT_NOT_NULL(snapshots);
+    Raycaster* old = raycast_snapshot_acquire(snapshots, 0);
+
+    // Edits to the live map are journaled and stay invisible to the pinned epoch
+    raycast_draw(raycaster, &pillar, &other);
+    TEST_ASSERT_EQUAL_INT(1, raycast_get_edits(raycaster, revision, edits));
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, edits[0].y);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, edits[0].h);
+    raycast_render_buffer(raycaster, &camera, after, NULL, 32, 24, &bg);
+    TEST_ASSERT_TRUE(memcmp(before, after, sizeof(before)) != 0);
+    TEST_ASSERT_EQUAL_INT(0, raycast_snapshots_publish(snapshots));
+
+    raycast_render_buffer(old, &camera, actual, NULL, 32, 24, &bg);
+    TEST_ASSERT_EQUAL_MEMORY(before, actual, sizeof(before));
+    TEST_ASSERT_EQUAL_INT(RAYCAST_EMPTY, raycast_get_cell(old, 6, 20));
+
+    // Only the chunk holding the edited rows was copied
+    Raycaster* current = raycast_snapshot_acquire(snapshots, 1);
+    raycast_render_buffer(current, &camera, actual, NULL, 32, 24, &bg);
+    TEST_ASSERT_EQUAL_MEMORY(after, actual, sizeof(after));
+    TEST_ASSERT_EQUAL_INT(other, raycast_get_cell(current, 6, 20));
+    TEST_ASSERT_TRUE(raycast_collides(current, 6.5f, 20.5f));
+    TEST_ASSERT_EQUAL_PTR(old->rows[0], current->rows[0]);
+    TEST_ASSERT_EQUAL_PTR(old->rows[39], current->rows[39]);
+    TEST_ASSERT_TRUE(old->rows[20] != current->rows[20]);
+
+    raycast_snapshot_release(snapshots, 0);
+    raycast_snapshot_release(snapshots, 1);
+    TEST_ASSERT_EQUAL_INT(0, raycast_snapshots_publish(snapshots));
+    raycast_snapshots_destroy(snapshots);
+}
+
+void test_raycast_pathfinding(void) {
+    RaycastColor wall  = 0xFF00FF00;
+    RaycastRect  all   = { 0, 0, 16, 12 };
+    RaycastRect  inner = { 1, 1, 14, 10 };
+    RaycastRect  fence = { 8, 1, 1, 9 };
+    RaycastRect  gap   = { 8, 10, 1, 1 };
+    int          path[64];
+
+    INIT(16, 12);
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+    raycast_draw(raycaster, &fence, &wall);
+
+    RaycastPathfinder* pathfinder = raycast_pathfinder_create(raycaster);
+    TEST_ASSERT_NOT_NULL(pathfinder);
+
+    // Waypoints are joined by free straight or diagonal lines that never cut a corner
+    int length = raycast_find_path(pathfinder, 2, 2, 13, 2, path, 32);
+    TEST_ASSERT_TRUE(length >= 3);
+    TEST_ASSERT_EQUAL_INT(2, path[0]);
+    TEST_ASSERT_EQUAL_INT(2, path[1]);
+    TEST_ASSERT_EQUAL_INT(13, path[length * 2 - 2]);
+    TEST_ASSERT_EQUAL_INT(2, path[length * 2 - 1]);
+    for (int i = 1; i < length; i++) {
+        int x  = path[i * 2 - 2];
+        int y  = path[i * 2 - 1];
+        int dx = path[i * 2] - x;
+        int dy = path[i * 2 + 1] - y;
+        TEST_ASSERT_TRUE(dx == 0 || dy == 0 || abs(dx) == abs(dy));
+        dx = (dx > 0) - (dx < 0);
+        dy = (dy > 0) - (dy < 0);
+        while (x != path[i * 2] || y != path[i * 2 + 1]) {
+            TEST_ASSERT_FALSE(dx && dy && raycast_collides(raycaster, x + dx + 0.5f, y + 0.5f));
+            TEST_ASSERT_FALSE(dx && dy && raycast_collides(raycaster, x + 0.5f, y + dy + 0.5f));
+            x += dx;
+            y += dy;
+            TEST_ASSERT_FALSE(raycast_collides(raycaster, x + 0.5f, y + 0.5f));
+        }
+    }
+
+    // Edits to the map are picked up without recreating the pathfinder
+    raycast_draw(raycaster, &gap, &wall);
+    TEST_ASSERT_EQUAL_INT(0, raycast_find_path(pathfinder, 2, 2, 13, 2, path, 32));
+    raycast_erase(raycaster, &gap);
+    TEST_ASSERT_EQUAL_INT(length, raycast_find_path(pathfinder, 2, 2, 13, 2, path, 32));
+
+    // A batch spread over a pool gives the same answers as one query at a time
+    RaycastThreadPool* pool = raycast_thread_pool_create(4);
+    RaycastPathQuery   queries[12];
+    int                paths[12][64];
+    TEST_ASSERT_NOT_NULL(pool);
+    for (int i = 0; i < 12; i++) {
+        queries[i]
+            = (RaycastPathQuery){ 1 + i, 1 + i % 10, 14 - i % 6, 10 - i % 9, paths[i], 32, -1 };
+    }
+    raycast_find_paths(pathfinder, queries, 12, pool);
+    for (int i = 0; i < 12; i++) {
+        int expected = raycast_find_path(pathfinder,
+                                         queries[i].startX,
+                                         queries[i].startY,
+                                         queries[i].goalX,
+                                         queries[i].goalY,
+                                         path,
+                                         32);
+        TEST_ASSERT_EQUAL_INT(expected, queries[i].length);
+        TEST_ASSERT_EQUAL_MEMORY(path, paths[i], expected * 2 * sizeof(int));
+    }
+
+    raycast_thread_pool_destroy(pool);
+    raycast_pathfinder_destroy(pathfinder);
+}
+
+void test_raycast_move_bodies(void) {
+    RaycastColor wall   = 0xFF00FF00;
+    RaycastRect  all    = { 0, 0, 16, 8 };
+    RaycastRect  inner  = { 1, 1, 14, 6 };
+    RaycastRect  pillar = { 8, 3, 2, 2 };
+    float        x      = 3.0f;
+    float        y      = 1.5f;
+    float        vx     = 2.0f;
+    float        vy     = -2.0f;
+    float        radius = 0.3f;
+
+    INIT(16, 8);
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+    raycast_draw(raycaster, &pillar, &wall);
+
+    // A body moving diagonally into a wall slides along it instead of stopping
+    RaycastBodies one = { &x, &y, &vx, &vy, &radius, 1 };
+    raycast_move_bodies(raycaster, &one, 1.0f, NULL);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 5.0f, x);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.3f, y);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, vx);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, vy);
+
+    // A batch spread over a pool matches moving each body alone, and no body ends in a wall
+    enum { COUNT = 1000 };
+    static float       bx[COUNT], by[COUNT], bvx[COUNT], bvy[COUNT], br[COUNT];
+    static float       sx[COUNT], sy[COUNT], svx[COUNT], svy[COUNT];
+    RaycastThreadPool* pool = raycast_thread_pool_create(4);
+    TEST_ASSERT_NOT_NULL(pool);
+    srand(7);
+    for (int i = 0; i < COUNT; i++) {
+        bx[i] = sx[i] = 1.5f + (rand() % 1300) / 100.0f;
+        by[i] = sy[i] = 1.5f + (rand() % 500) / 100.0f;
+        bvx[i] = svx[i] = (rand() % 2001 - 1000) / 100.0f;
+        bvy[i] = svy[i] = (rand() % 2001 - 1000) / 100.0f;
+        br[i]           = 0.1f + (rand() % 40) / 100.0f;
+    }
+
+    RaycastBodies batch = { bx, by, bvx, bvy, br, COUNT };
+    raycast_move_bodies(raycaster, &batch, 0.5f, pool);
+    for (int i = 0; i < COUNT; i++) {
+        RaycastBodies alone = { &sx[i], &sy[i], &svx[i], &svy[i], &br[i], 1 };
+        raycast_move_bodies(raycaster, &alone, 0.5f, NULL);
+        TEST_ASSERT_EQUAL_MEMORY(&sx[i], &bx[i], sizeof(float));
+        TEST_ASSERT_EQUAL_MEMORY(&sy[i], &by[i], sizeof(float));
+        TEST_ASSERT_EQUAL_MEMORY(&svx[i], &bvx[i], sizeof(float));
+        TEST_ASSERT_EQUAL_MEMORY(&svy[i], &bvy[i], sizeof(float));
+        TEST_ASSERT_FALSE(raycast_collides(raycaster, bx[i], by[i]));
+    }
+
+    // Non-finite bodies are left alone, and a huge velocity takes a bounded number of substeps
+    x  = 3.0f;
+    y  = 3.0f;
+    vx = NAN;
+    vy = 1.0f;
+    raycast_move_bodies(raycaster, &one, 1.0f, NULL);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, x);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, y);
+    vx = 1e30f;
+    vy = 0.0f;
+    raycast_move_bodies(raycaster, &one, 1.0f, NULL);
+    TEST_ASSERT_TRUE(x >= -1.0f && x <= raycaster->width + 1.0f);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, y);
+    raycast_move_bodies(raycaster, &one, INFINITY, NULL);
+    TEST_ASSERT_TRUE(x >= -1.0f && x <= raycaster->width + 1.0f);
+
+    raycast_thread_pool_destroy(pool);
+}
+
+static bool solid(int x, int y) {
+    return x < 0 || x >= raycaster->width || y < 0 || y >= raycaster->height
+           || raycast_collides(raycaster, x + 0.5f, y + 0.5f);
+}
+
+// Unfiltered cell walk between two cell centers, as raycast_line_of_sight() defines it
+static bool reference_sight(int x0, int y0, int x1, int y1) {
+    int  dx    = 2 * abs(x1 - x0);
+    int  dy    = 2 * abs(y1 - y0);
+    int  sx    = (x1 > x0) ? 1 : -1;
+    int  sy    = (y1 > y0) ? 1 : -1;
+    int  error = (dx - dy) / 2;
+    bool clear = !solid(x0, y0);
+    while (clear && (x0 != x1 || y0 != y1)) {
+        int step = error;
+        if (step == 0 && solid(x0 + sx, y0) && solid(x0, y0 + sy)) {
+            return false;
+        }
+        if (step >= 0) {
+            x0 += sx;
+            error -= dy;
+        }
+        if (step <= 0) {
+            y0 += sy;
+            error += dx;
+        }
+        clear = !solid(x0, y0);
+    }
+    return clear;
+}
+
+void test_raycast_line_of_sight(void) {
+    RaycastColor wall    = 0xFF00FF00;
+    RaycastRect  all     = { 0, 0, 32, 16 };
+    RaycastRect  inner   = { 1, 1, 30, 14 };
+    RaycastRect  divider = { 15, 1, 2, 14 };
+    RaycastRect  door    = { 15, 7, 2, 2 };
+
+    INIT(32, 16);
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+    raycast_draw(raycaster, &divider, &wall);
+
+    RaycastThreadPool* pool       = raycast_thread_pool_create(4);
+    RaycastVisibility* visibility = raycast_visibility_create(raycaster, pool);
+    TEST_ASSERT_NOT_NULL(pool);
+    TEST_ASSERT_NOT_NULL(visibility);
+
+    TEST_ASSERT_TRUE(raycast_line_of_sight(visibility, 2, 2, 13, 13));
+    TEST_ASSERT_FALSE(raycast_line_of_sight(visibility, 2, 8, 29, 8));
+    TEST_ASSERT_FALSE(raycast_line_of_sight(visibility, 2, 8, 15, 8));
+
+    // Opening a door only rebuilds the pairs around it, and matches a fresh build
+    raycast_erase(raycaster, &door);
+    TEST_ASSERT_FALSE(raycast_line_of_sight(visibility, 2, 8, 29, 8));
+    TEST_ASSERT_EQUAL_INT(0, raycast_visibility_update(visibility, pool));
+    TEST_ASSERT_TRUE(raycast_line_of_sight(visibility, 2, 8, 29, 8));
+    TEST_ASSERT_TRUE(raycast_line_of_sight(visibility, 29, 8, 2, 8));
+    TEST_ASSERT_FALSE(raycast_line_of_sight(visibility, 2, 2, 29, 2));
+
+    RaycastVisibility* fresh = raycast_visibility_create(raycaster, NULL);
+    TEST_ASSERT_NOT_NULL(fresh);
+    for (int a = 0; a < 32 * 16; a++) {
+        for (int b = 0; b < 32 * 16; b++) {
+            TEST_ASSERT_EQUAL(raycast_line_of_sight(fresh, a % 32, a / 32, b % 32, b / 32),
+                              raycast_line_of_sight(visibility, a % 32, a / 32, b % 32, b / 32));
+        }
+    }
+
+    // Scattered pillars and a few incremental edits: the filtered answer is the exact walk
+    for (int i = 0; i < 60; i++) {
+        RaycastRect pillar = { (float) ((i * 37) % 30 + 1), (float) ((i * 11) % 14 + 1), 1, 1 };
+        raycast_draw(raycaster, &pillar, &wall);
+    }
+    TEST_ASSERT_EQUAL_INT(0, raycast_visibility_update(visibility, pool));
+    for (int edit = 0; edit < 4; edit++) {
+        RaycastRect cell = { (float) (edit * 7 + 3), (float) (edit * 3 + 2), 2, 1 };
+        if (edit % 2) {
+            raycast_erase(raycaster, &cell);
+        } else {
+            raycast_draw(raycaster, &cell, &wall);
+        }
+        TEST_ASSERT_EQUAL_INT(0, raycast_visibility_update(visibility, pool));
+        for (int a = 0; a < 32 * 16; a++) {
+            for (int b = 0; b < 32 * 16; b++) {
+                int x0 = a % 32, y0 = a / 32, x1 = b % 32, y1 = b / 32;
+                TEST_ASSERT_EQUAL(reference_sight(x0, y0, x1, y1),
+                                  raycast_line_of_sight(visibility, x0, y0, x1, y1));
+            }
+        }
+    }
+
+    raycast_visibility_destroy(fresh);
+    raycast_visibility_destroy(visibility);
+    raycast_thread_pool_destroy(pool);
+}
+
+void test_raycast_thin_walls(void) {
+    RaycastColor    wall   = 0xFF00FF00;
+    RaycastColor    door   = 0xFF0000FF;
+    RaycastRect     all    = { 0, 0, 16, 8 };
+    RaycastRect     inner  = { 1, 1, 14, 6 };
+    RaycastRect     cells  = { 8, 3, 1, 1 };
+    RaycastRect     panel  = { 4, 5, 1, 1 };
+    RaycastThinWall closed = { 0, 0.5f, RAYCAST_THIN_VERTICAL, 0.0f };
+    RaycastThinWall fence  = { 0, 0.25f, RAYCAST_THIN_HORIZONTAL, 0.0f };
+    RaycastHit      hit;
+
+    INIT(16, 8);
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+    raycast_draw(raycaster, &cells, &door);
+    raycast_draw(raycaster, &panel, &door);
+
+    Uint64 revision = raycaster->revision;
+    TEST_ASSERT_EQUAL_INT(0, raycast_set_thin_wall(raycaster, 8, 3, &closed));
+    TEST_ASSERT_EQUAL_INT(0, raycast_set_thin_wall(raycaster, 4, 5, &fence));
+    TEST_ASSERT_EQUAL_INT(1, raycast_set_thin_wall(raycaster, 16, 3, &closed));
+    TEST_ASSERT_EQUAL_INT(2, (int) (raycaster->revision - revision));
+
+    // A closed door is hit at its panel, halfway into the cell
+    raycast_cast_textured(raycaster, 2.5f, 3.5f, 0.0f, &hit);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 6.0f, hit.distance);
+    TEST_ASSERT_EQUAL_INT(0, hit.side);
+    TEST_ASSERT_EQUAL_INT(3 * 16 + 8, hit.cell);
+    TEST_ASSERT_EQUAL_INT(door, hit.textureId);
+    TEST_ASSERT_TRUE(raycast_collides(raycaster, 8.5f, 3.5f));
+
+    // Opening the door is a single write: the panel slides and the texture slides with it
+    RaycastThinWall* animated = raycast_get_thin_wall(raycaster, 8, 3);
+    TEST_ASSERT_NOT_NULL(animated);
+    animated->open = 0.3f;
+    raycast_cast_textured(raycaster, 2.5f, 3.5f, 0.0f, &hit);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 6.0f, hit.distance);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.2f, hit.wallX);
+    animated->open = 0.6f;
+    raycast_cast_textured(raycaster, 2.5f, 3.5f, 0.0f, &hit);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.5f, hit.distance);
+    TEST_ASSERT_EQUAL_INT(wall, hit.textureId);
+    TEST_ASSERT_TRUE(raycast_collides(raycaster, 8.5f, 3.5f));
+    animated->open = 1.0f;
+    TEST_ASSERT_FALSE(raycast_collides(raycaster, 8.5f, 3.5f));
+
+    // Horizontal panels are hit on side 1, also from inside their own cell
+    raycast_cast_textured(raycaster, 4.5f, 6.5f, -90.0f, &hit);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.25f, hit.distance);
+    TEST_ASSERT_EQUAL_INT(1, hit.side);
+    raycast_cast_textured(raycaster, 4.5f, 5.5f, -90.0f, &hit);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.25f, hit.distance);
+
+    raycast_remove_thin_wall(raycaster, 4, 5);
+    TEST_ASSERT_NULL(raycast_get_thin_wall(raycaster, 4, 5));
+    raycast_cast_textured(raycaster, 4.5f, 6.5f, -90.0f, &hit);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, hit.distance);
+
+    // Door changes reach the journal through raycast_mark_cell, so caches see the door open
+    RaycastRect divider = { 8, 1, 1, 6 };
+    RaycastRect edits[RAYCAST_EDIT_JOURNAL];
+    int         route[64];
+    raycast_draw(raycaster, &divider, &wall);
+    raycast_draw(raycaster, &cells, &door);
+    animated                      = raycast_get_thin_wall(raycaster, 8, 3);
+    animated->open                = 0.0f;
+
+    RaycastPathfinder* pathfinder = raycast_pathfinder_create(raycaster);
+    TEST_ASSERT_NOT_NULL(pathfinder);
+    TEST_ASSERT_EQUAL_INT(0, raycast_find_path(pathfinder, 2, 3, 12, 3, route, 32));
+    revision       = raycaster->revision;
+    animated->open = 1.0f;
+    raycast_mark_cell(raycaster, 8, 3);
+    TEST_ASSERT_EQUAL_INT(1, raycast_get_edits(raycaster, revision, edits));
+    TEST_ASSERT_EQUAL_INT(8, (int) edits[0].x);
+    TEST_ASSERT_EQUAL_INT(3, (int) edits[0].y);
+    TEST_ASSERT_TRUE(raycast_find_path(pathfinder, 2, 3, 12, 3, route, 32) > 0);
+    raycast_pathfinder_destroy(pathfinder);
+
+    // Erasing a cell drops its panel, so redrawing it gives a full block again
+    raycast_erase(raycaster, &cells);
+    TEST_ASSERT_NULL(raycast_get_thin_wall(raycaster, 8, 3));
+    TEST_ASSERT_EQUAL_INT(0, raycaster->thinWallCount);
+    raycast_draw(raycaster, &cells, &door);
+    raycast_cast_textured(raycaster, 2.5f, 3.5f, 0.0f, &hit);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 5.5f, hit.distance);
+}
+
+void test_raycast_translucent_layers(void) {
+    RaycastColor    wall      = 0xFF00FF00;
+    RaycastColor    glass     = 0x80FF0000;
+    RaycastColor    bg        = 0xFF000000;
+    RaycastRect     all       = { 0, 0, 16, 8 };
+    RaycastRect     inner     = { 1, 1, 14, 6 };
+    RaycastRect     pane      = { 6, 3, 1, 1 };
+    RaycastRect     row       = { 3, 5, 8, 1 };
+    RaycastCellType wallType  = { wall, -1, 1, 0 };
+    RaycastCellType glassType = { glass, -1, 1, 1 };
+    RaycastCamera   camera    = { 2.5f, 3.5f, 1.0f, 0.0f, 0.0f, 0.66f, 60 };
+    RaycastColor    opaque[32 * 24];
+    RaycastColor    tinted[32 * 24];
+    RaycastHitList  layers;
+
+    // Raw map colors stay opaque whatever their alpha
+    INIT(16, 8);
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+    raycast_draw(raycaster, &pane, &glass);
+    raycast_cast_layers(raycaster, 2.5f, 3.5f, 0.0f, &layers);
+    TEST_ASSERT_EQUAL_INT(1, layers.count);
+    TEST_ASSERT_EQUAL_INT(3 * 16 + 6, layers.hits[0].cell);
+    raycast_destroy(raycaster);
+
+    raycaster            = raycast_init_compact(16, 8, 8);
+    RaycastColor wallId  = raycast_add_cell_type(raycaster, &wallType);
+    RaycastColor glassId = raycast_add_cell_type(raycaster, &glassType);
+    raycast_draw(raycaster, &all, &wallId);
+    raycast_erase(raycaster, &inner);
+
+    // Opaque walls keep the single-hit path
+    raycast_cast_layers(raycaster, 2.5f, 3.5f, 0.0f, &layers);
+    TEST_ASSERT_EQUAL_INT(1, layers.count);
+    raycast_render_buffer(raycaster, &camera, opaque, NULL, 32, 24, &bg);
+
+    // The wall behind a pane of glass flagged translucent shows through, tinted by the glass
+    raycast_draw(raycaster, &pane, &glassId);
+    raycast_cast_layers(raycaster, 2.5f, 3.5f, 0.0f, &layers);
+    TEST_ASSERT_EQUAL_INT(2, layers.count);
+    TEST_ASSERT_EQUAL_INT(3 * 16 + 6, layers.hits[0].cell);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 3.5f, layers.hits[0].distance);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.5f, layers.hits[1].distance);
+    raycast_render_buffer(raycaster, &camera, tinted, NULL, 32, 24, &bg);
+    RaycastColor behind = opaque[11 * 32 + 16];
+    RaycastColor mixed  = tinted[11 * 32 + 16];
+    TEST_ASSERT_EQUAL_HEX32(wall, behind);
+    TEST_ASSERT_TRUE(((mixed >> 16) & 0xFF) > 0x60 && ((mixed >> 8) & 0xFF) > 0x60);
+    TEST_ASSERT_EQUAL_HEX32(0xFF000000, (uint32_t) mixed & 0xFF000000);
+
+    // Long runs of glass keep the nearest layers and always end on the opaque wall
+    raycast_draw(raycaster, &row, &glassId);
+    raycast_cast_layers(raycaster, 1.5f, 5.5f, 0.0f, &layers);
+    TEST_ASSERT_EQUAL_INT(RAYCAST_MAX_HITS, layers.count);
+    TEST_ASSERT_EQUAL_INT(5 * 16 + 3, layers.hits[0].cell);
+    TEST_ASSERT_EQUAL_INT(5 * 16 + 15, layers.hits[RAYCAST_MAX_HITS - 1].cell);
+
+    // Texture translucency comes from the alpha of its texels
+    RaycastTexture* grate = raycast_texture_create(2, 1);
+    TEST_ASSERT_NOT_NULL(grate);
+    grate->pixels[0] = 0xFF404040;
+    grate->pixels[1] = 0xFF404040;
+    TEST_ASSERT_FALSE(raycast_texture_scan_alpha(grate));
+    grate->pixels[1] = 0x00000000;
+    TEST_ASSERT_TRUE(raycast_texture_scan_alpha(grate));
+    raycast_texture_destroy(grate);
+}
+
+void test_raycast_column_kernels(void) {
+    RaycastColor  bg     = 0xFF000000;
+    RaycastRect   all    = { 0, 0, 16, 16 };
+    RaycastRect   inner  = { 1, 1, 14, 14 };
+    RaycastColor  id     = 0;
+    RaycastCamera camera = { 4.5f, 5.5f, 0.7f, 0.7f, 0.0f, 0.66f, 90 };
+    RaycastColor  pixels[40 * 30];
+    int           heights[2] = { 8, 6 };
+
+    // Every variant (ARGB, indexed or shaded-palette texels, power-of-two height, side shading,
+    // fog) matches a per-pixel walk; each runs on a fresh Raycaster
+    for (int variant = 0; variant < 6; variant++) {
+        int             source  = variant / 2;
+        int             height  = heights[variant % 2];
+        RaycastTexture* texture = raycast_texture_create(4, height);
+        for (int i = 0; i < 4 * height; i++) {
+            texture->pixels[i] = 0xFF000000 | (uint32_t) (i * 0x0B1D2F);
+        }
+        RaycastTexture* indexed = (source > 0) ? raycast_texture_to_indexed(texture, NULL) : NULL;
+
+        INIT(16, 16);
+        raycast_draw(raycaster, &all, &id);
+        raycast_erase(raycaster, &inner);
+        raycaster->maxDistance = 20.0f;
+        raycaster->fogColor    = 0xFF808080;
+        if (source == 2) {
+            TEST_ASSERT_EQUAL_INT(0, raycast_palette_build_shades(indexed->palette, 0xFF808080));
+        }
+        raycast_add_texture(raycaster, indexed ? indexed : texture);
+        raycast_render_buffer(raycaster, &camera, pixels, NULL, 40, 30, &bg);
+
+        float direction = atan2f(camera.dirY, camera.dirX) * (180.0f / M_PI);
+        int   sides[2]  = { 0, 0 };
+        for (int x = 0; x < 40; x++) {
+            RaycastHit hit;
+            float      angle = direction - (camera.fov / 2.0f) + (camera.fov * x) / 40;
+            raycast_cast_textured(raycaster, camera.posX, camera.posY, angle, &hit);
+            int wallHeight = (int) (30 / (hit.distance + 0.0001f));
+            int wallTop    = (30 - wallHeight) / 2;
+            int texX       = (int) (hit.wallX * 4);
+            int fog        = (int) (hit.distance * 256.0f / raycaster->maxDistance);
+            int level      = (fog * (RAYCAST_FOG_LEVELS - 1) + 128) >> 8;
+            sides[hit.side]++;
+            for (int y = SDL_max(wallTop, 0); y < SDL_min(wallTop + wallHeight, 30); y++) {
+                int          texY  = (int) ((float) (y - wallTop) / (float) wallHeight * height);
+                RaycastColor color = texture->pixels[texY * 4 + texX];
+                int          r     = (color >> 16) & 0xFF;
+                int          g     = (color >> 8) & 0xFF;
+                int          b     = color & 0xFF;
+                if (hit.side == 1) {
+                    r /= 2;
+                    g /= 2;
+                    b /= 2;
+                }
+                r += ((0x80 - r) * fog) >> 8;
+                g += ((0x80 - g) * fog) >> 8;
+                b += ((0x80 - b) * fog) >> 8;
+                RaycastColor expected = 0xFF000000 | (r << 16) | (g << 8) | b;
+                if (source == 2) {
+                    const RaycastColor* shades
+                        = indexed->palette->shades
+                          + (hit.side * RAYCAST_FOG_LEVELS + level) * RAYCAST_PALETTE_SIZE;
+                    expected = shades[indexed->indices[texY * 4 + texX]];
+                }
+                TEST_ASSERT_EQUAL_HEX32(expected, pixels[y * 40 + x]);
+            }
+        }
+        TEST_ASSERT_TRUE(sides[0] > 0 && sides[1] > 0);
+
+        // The Raycaster owns the texture it was given
+        raycast_destroy(raycaster);
+        raycaster = NULL;
+        raycast_texture_destroy(indexed ? texture : NULL);
+    }
+}
+
+void test_raycast_pixel_formats(void) {
+    RaycastColor    bg         = 0xFF102030;
+    RaycastRect     all        = { 0, 0, 16, 16 };
+    RaycastRect     inner      = { 1, 1, 14, 14 };
+    RaycastRect     pillar     = { 6, 6, 1, 1 };
+    RaycastColor    id         = 0;
+    RaycastColor    red        = 0xFFC04020;
+    RaycastCamera   cameras[2] = { { 3.5f, 4.5f, 0.7f, 0.7f, 0.0f, 0.66f, 90 },
+                                   { 12.5f, 3.5f, -1.0f, 0.3f, 0.0f, 0.66f, 70 } };
+    RaycastTexture* texture    = raycast_texture_create(8, 8);
+    RaycastColor    expected[2 * 40 * 30];
+    Uint32          actual[2 * 40 * 30];
+    for (int i = 0; i < 64; i++) {
+        texture->pixels[i] = 0xFF000000 | (uint32_t) (i * 0x0B1D2F);
+    }
+
+    INIT(16, 16);
+    raycast_draw(raycaster, &all, &id);
+    raycast_erase(raycaster, &inner);
+    raycast_draw(raycaster, &pillar, &red);
+    raycast_add_texture(raycaster, texture);
+    raycaster->maxDistance = 20.0f;
+    raycaster->fogColor    = 0xFF808080;
+    raycast_render_batch(raycaster, cameras, 2, NULL, expected, NULL, 40, 30, &bg);
+
+    // Every format writes the converted ARGB image, including the second view of a batch
+    RaycastPixelFormat formats[3]
+        = { RAYCAST_PIXEL_XRGB8888, RAYCAST_PIXEL_ABGR8888, RAYCAST_PIXEL_RGB565 };
+    for (int f = 0; f < 3; f++) {
+        raycaster->pixelFormat = formats[f];
+        raycast_render_batch(raycaster, cameras, 2, NULL, actual, NULL, 40, 30, &bg);
+        for (int i = 0; i < 2 * 40 * 30; i++) {
+            Uint32 pixel
+                = (formats[f] == RAYCAST_PIXEL_RGB565) ? ((uint16_t*) actual)[i] : actual[i];
+            TEST_ASSERT_EQUAL_HEX32(raycast_convert_color(expected[i], formats[f]), pixel);
+        }
+    }
+
+    TEST_ASSERT_EQUAL_HEX32(0x7F3020C0, raycast_convert_color(0x7FC02030, RAYCAST_PIXEL_ABGR8888));
+    TEST_ASSERT_EQUAL_HEX32(0xFFC02030, raycast_convert_color(0x7FC02030, RAYCAST_PIXEL_XRGB8888));
+    TEST_ASSERT_EQUAL_HEX32(0xF884, raycast_convert_color(0xFFFF1020, RAYCAST_PIXEL_RGB565));
+    TEST_ASSERT_EQUAL_INT(2, raycast_pixel_size(RAYCAST_PIXEL_RGB565));
+    TEST_ASSERT_EQUAL_INT(4, raycast_pixel_size(RAYCAST_PIXEL_ABGR8888));
+
+    // A pixel format outside the enum renders nothing instead of picking a kernel out of range
+    memset(actual, 0x5A, sizeof(actual));
+    raycaster->pixelFormat = (RaycastPixelFormat) 7;
+    raycast_render_batch(raycaster, cameras, 2, NULL, actual, NULL, 40, 30, &bg);
+    TEST_ASSERT_EQUAL_HEX32(0x5A5A5A5A, actual[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x5A5A5A5A, actual[2 * 40 * 30 - 1]);
+    raycaster->pixelFormat = RAYCAST_PIXEL_ARGB8888;
+}
+
+void test_raycast_stream(void) {
+    RaycastColor  bg      = 0xFF102030;
+    RaycastRect   all     = { 0, 0, 16, 16 };
+    RaycastRect   inner   = { 1, 1, 14, 14 };
+    RaycastColor  wall    = 0xFF40C020;
+    RaycastCamera path[3] = { { 3.5f, 4.5f, 1.0f, 0.0f, 0.0f, 0.66f, 90 },
+                              { 4.5f, 4.5f, 0.7f, 0.7f, 0.0f, 0.66f, 90 },
+                              { 5.5f, 5.5f, 0.0f, 1.0f, 0.0f, 0.66f, 90 } };
+    RaycastColor  expected[10 * 6];
+    uint8_t       data[3 * 10 * 6 * 4];
+    char          header[64];
+    FILE*         file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+
+    INIT(16, 16);
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+
+    // Raw RGBA: the frames of the path, back to back, with enough buffers to never drop
+    RaycastStream* stream
+        = raycast_stream_create(raycaster, NULL, fileno(file), RAYCAST_STREAM_RGBA, 10, 6, 30, 3);
+    TEST_ASSERT_NOT_NULL(stream);
+    TEST_ASSERT_EQUAL_INT(3, raycast_stream_path(stream, path, 3, &bg));
+    raycast_stream_flush(stream);
+
+    RaycastStreamStats stats;
+    raycast_stream_stats(stream, &stats);
+    TEST_ASSERT_EQUAL_INT(3, stats.rendered);
+    TEST_ASSERT_EQUAL_INT(3, stats.written);
+    TEST_ASSERT_EQUAL_INT(0, stats.dropped);
+    TEST_ASSERT_EQUAL_INT(sizeof(data), stats.bytes);
+    TEST_ASSERT_FALSE(stats.failed);
+
+    // Frames are dropped while the Raycaster renders in another pixel format than the buffers
+    raycaster->pixelFormat = RAYCAST_PIXEL_RGB565;
+    TEST_ASSERT_FALSE(raycast_stream_frame(stream, &path[0], &bg));
+    raycaster->pixelFormat = RAYCAST_PIXEL_ARGB8888;
+    raycast_stream_stats(stream, &stats);
+    TEST_ASSERT_EQUAL_INT(3, stats.rendered);
+    TEST_ASSERT_EQUAL_INT(1, stats.dropped);
+    raycast_stream_destroy(stream);
+
+    rewind(file);
+    TEST_ASSERT_EQUAL_INT(sizeof(data), fread(data, 1, sizeof(data), file));
+    for (int f = 0; f < 3; f++) {
+        raycast_render_buffer(raycaster, &path[f], expected, NULL, 10, 6, &bg);
+        for (int i = 0; i < 10 * 6; i++) {
+            const uint8_t* rgba = data + (f * 10 * 6 + i) * 4;
+            TEST_ASSERT_EQUAL_HEX32(expected[i] & 0xFFFFFF,
+                                    (rgba[0] << 16) | (rgba[1] << 8) | rgba[2]);
+            TEST_ASSERT_EQUAL_HEX32(0xFF, rgba[3]);
+        }
+    }
+
+    // Y4M: header, then a FRAME line and the Y, Cb and Cr planes of each frame. Flushing after
+    // every frame keeps the single buffer free, so no frame is dropped.
+    fclose(file);
+    file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    stream = raycast_stream_create(raycaster, NULL, fileno(file), RAYCAST_STREAM_Y4M, 10, 6, 25, 1);
+    TEST_ASSERT_NOT_NULL(stream);
+    for (int f = 0; f < 3; f++) {
+        TEST_ASSERT_TRUE(raycast_stream_frame(stream, &path[f], &bg));
+        raycast_stream_flush(stream);
+    }
+    raycast_stream_stats(stream, &stats);
+    TEST_ASSERT_EQUAL_INT(3, stats.written);
+    TEST_ASSERT_EQUAL_INT(0, stats.dropped);
+    raycast_stream_destroy(stream);
+
+    const char* expectedHeader = "YUV4MPEG2 W10 H6 F25:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n";
+    long        frameSize      = 6 + 10 * 6 + 2 * 5 * 3;
+    uint8_t     frame[6 + 10 * 6 + 2 * 5 * 3];
+    TEST_ASSERT_EQUAL_INT(0, fseek(file, 0, SEEK_END));
+    TEST_ASSERT_EQUAL_INT((long) strlen(expectedHeader) + 3 * frameSize, ftell(file));
+    rewind(file);
+    TEST_ASSERT_NOT_NULL(fgets(header, sizeof(header), file));
+    TEST_ASSERT_EQUAL_MEMORY(expectedHeader, header, strlen(expectedHeader) + 1);
+
+    // Full-range BT.601: luma per pixel, chroma from the average of each 2x2 block
+    for (int f = 0; f < 3; f++) {
+        TEST_ASSERT_EQUAL_INT(1, fread(frame, sizeof(frame), 1, file));
+        TEST_ASSERT_EQUAL_MEMORY("FRAME\n", frame, 6);
+        raycast_render_buffer(raycaster, &path[f], expected, NULL, 10, 6, &bg);
+        for (int i = 0; i < 10 * 6; i++) {
+            float r = (float) ((expected[i] >> 16) & 0xFF);
+            float g = (float) ((expected[i] >> 8) & 0xFF);
+            float b = (float) (expected[i] & 0xFF);
+            TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.299f * r + 0.587f * g + 0.114f * b, frame[6 + i]);
+        }
+        for (int c = 0; c < 5 * 3; c++) {
+            float rgb[3] = { 0.0f, 0.0f, 0.0f };
+            for (int i = 0; i < 4; i++) {
+                RaycastColor color = expected[((c / 5) * 2 + i / 2) * 10 + (c % 5) * 2 + i % 2];
+                rgb[0] += ((color >> 16) & 0xFF) / 4.0f;
+                rgb[1] += ((color >> 8) & 0xFF) / 4.0f;
+                rgb[2] += (color & 0xFF) / 4.0f;
+            }
+            float cb = 128.0f - 0.168736f * rgb[0] - 0.331264f * rgb[1] + 0.5f * rgb[2];
+            float cr = 128.0f + 0.5f * rgb[0] - 0.418688f * rgb[1] - 0.081312f * rgb[2];
+            TEST_ASSERT_FLOAT_WITHIN(1.5f, cb, frame[6 + 10 * 6 + c]);
+            TEST_ASSERT_FLOAT_WITHIN(1.5f, cr, frame[6 + 10 * 6 + 5 * 3 + c]);
+        }
+    }
+
+    fclose(file);
+}
+
+void test_raycast_terrain(void) {
+    static uint8_t     heights[64 * 64];
+    RaycastColor       sky     = 0xFF80C0FF;
+    RaycastColor       grass   = 0xFF208020;
+    RaycastColor       rock    = 0xFF806040;
+    RaycastRect        all     = { 0, 0, 64, 64 };
+    RaycastRect        ridge   = { 40, 0, 2, 64 };
+    RaycastCamera      camera  = { 20.5f, 32.5f, 1.0f, 0.0f, 0.0f, 0.66f, 60 };
+    RaycastTerrain     terrain = { heights, 0.01f, 0.5f, 0.0f, 60.0f, 0.05f, 0.02f };
+    RaycastThreadPool* pool    = raycast_thread_pool_create(3);
+    RaycastColor       serial[40 * 60];
+    RaycastColor       threaded[40 * 60];
+
+    INIT(64, 64);
+    raycast_draw(raycaster, &all, &grass);
+    raycast_draw(raycaster, &ridge, &rock);
+    for (int y = 0; y < 64; y++) {
+        heights[y * 64 + 40] = 200;
+        heights[y * 64 + 41] = 200;
+    }
+
+    raycast_render_terrain(raycaster, &terrain, &camera, NULL, serial, 40, 60, &sky);
+    raycast_render_terrain(raycaster, &terrain, &camera, pool, threaded, 40, 60, &sky);
+    TEST_ASSERT_EQUAL_MEMORY(serial, threaded, sizeof(serial));
+
+    // Sky on top, near ground at the bottom, and the 2-cell ridge rising above the horizon
+    for (int x = 0; x < 40; x++) {
+        TEST_ASSERT_EQUAL_HEX32(sky, serial[x]);
+        TEST_ASSERT_EQUAL_HEX32(grass, serial[59 * 40 + x]);
+        TEST_ASSERT_EQUAL_HEX32(rock, serial[27 * 40 + x]);
+        TEST_ASSERT_EQUAL_HEX32(grass, serial[40 * 40 + x]);
+    }
+
+    // Looking away from the ridge, flat ground meets the sky at the horizon
+    camera.dirX = -1.0f;
+    raycast_render_terrain(raycaster, &terrain, &camera, NULL, serial, 40, 60, &sky);
+    TEST_ASSERT_EQUAL_HEX32(sky, serial[29 * 40 + 20]);
+    TEST_ASSERT_EQUAL_HEX32(grass, serial[31 * 40 + 20]);
+
+    raycast_thread_pool_destroy(pool);
+}
+
+void test_raycast_lightmap(void) {
+    RaycastColor       bg     = 0xFF000000;
+    RaycastRect        all    = { 0, 0, 16, 16 };
+    RaycastRect        inner  = { 1, 1, 14, 14 };
+    RaycastRect        pillar = { 2, 8, 1, 1 };
+    RaycastColor       id     = 0;
+    RaycastCamera      camera = { 8.5f, 8.5f, -1.0f, 0.0f, 0.0f, 0.66f, 60 };
+    RaycastLight       light  = { 3.5f, 8.5f, 6.0f, 191 };
+    RaycastThreadPool* pool   = raycast_thread_pool_create(3);
+    RaycastColor       unlit[20 * 40];
+    RaycastColor       pixels[20 * 40];
+    int                center = 20 * 20 + 10;
+    int                wall   = (8 * 16 + 0) * 4 + RAYCAST_FACE_EAST;
+
+    INIT(16, 16);
+    raycast_draw(raycaster, &all, &id);
+    raycast_erase(raycaster, &inner);
+    raycaster->maxDistance  = 20.0f;
+    RaycastTexture* texture = raycast_texture_create(4, 4);
+    for (int i = 0; i < 4 * 4; i++) {
+        texture->pixels[i] = 0xFFC0C0C0;
+    }
+    raycast_add_texture(raycaster, texture);
+    raycast_render_buffer(raycaster, &camera, unlit, NULL, 20, 40, &bg);
+
+    // Full ambient light leaves every wall as it was
+    RaycastLightmap* lightmap = raycast_lightmap_create(raycaster, 255, pool);
+    TEST_ASSERT_NOT_NULL(lightmap);
+    TEST_ASSERT_NOT_NULL(raycaster->lighting);
+    raycast_render_buffer(raycaster, &camera, pixels, NULL, 20, 40, &bg);
+    TEST_ASSERT_EQUAL_MEMORY(unlit, pixels, sizeof(pixels));
+    raycast_lightmap_destroy(lightmap);
+    TEST_ASSERT_NULL(raycaster->lighting);
+
+    // A light near the west wall brightens the faces within its radius
+    lightmap = raycast_lightmap_create(raycaster, 64, NULL);
+    TEST_ASSERT_NOT_NULL(lightmap);
+    raycast_render_buffer(raycaster, &camera, unlit, NULL, 20, 40, &bg);
+    int id0 = raycast_lightmap_add_light(lightmap, &light);
+    TEST_ASSERT_EQUAL_INT(0, id0);
+    TEST_ASSERT_EQUAL_INT(0, raycast_lightmap_update(lightmap, pool));
+    TEST_ASSERT_EQUAL_INT(64 + 111, raycaster->lighting->levels[wall]);
+    TEST_ASSERT_EQUAL_INT(64, raycaster->lighting->levels[(2 * 16 + 0) * 4 + RAYCAST_FACE_EAST]);
+    TEST_ASSERT_EQUAL_INT(64, raycaster->lighting->levels[(8 * 16 + 0) * 4 + RAYCAST_FACE_WEST]);
+    raycast_render_buffer(raycaster, &camera, pixels, NULL, 20, 40, &bg);
+    TEST_ASSERT_TRUE((pixels[center] & 0xFF) > (unlit[center] & 0xFF));
+
+    // Moving the light and editing the map relight incrementally, matching a fresh lightmap
+    light.x = 12.5f;
+    raycast_lightmap_set_light(lightmap, id0, &light);
+    TEST_ASSERT_EQUAL_INT(0, raycast_lightmap_update(lightmap, pool));
+    TEST_ASSERT_EQUAL_INT(64, raycaster->lighting->levels[wall]);
+    light.x = 3.5f;
+    raycast_lightmap_set_light(lightmap, id0, &light);
+    raycast_draw(raycaster, &pillar, &id);
+    TEST_ASSERT_EQUAL_INT(0, raycast_lightmap_update(lightmap, pool));
+    TEST_ASSERT_EQUAL_INT(64, raycaster->lighting->levels[wall]);
+    TEST_ASSERT_TRUE(raycaster->lighting->levels[(8 * 16 + 2) * 4 + RAYCAST_FACE_EAST] > 64);
+    const uint8_t*   levels = raycaster->lighting->levels;
+
+    RaycastLightmap* fresh  = raycast_lightmap_create(raycaster, 64, NULL);
+    TEST_ASSERT_NOT_NULL(fresh);
+    TEST_ASSERT_EQUAL_INT(0, raycast_lightmap_add_light(fresh, &light));
+    TEST_ASSERT_EQUAL_INT(0, raycast_lightmap_update(fresh, NULL));
+    TEST_ASSERT_TRUE(raycaster->lighting->levels != levels);
+    TEST_ASSERT_EQUAL_MEMORY(levels, raycaster->lighting->levels, 16 * 16 * 4);
+    raycast_lightmap_destroy(fresh);
+    TEST_ASSERT_NULL(raycaster->lighting);
+
+    // Removing the light returns every face to the ambient level
+    raycast_lightmap_remove_light(lightmap, id0);
+    TEST_ASSERT_EQUAL_INT(0, raycast_lightmap_update(lightmap, NULL));
+    for (int i = 0; i < 16 * 16 * 4; i++) {
+        TEST_ASSERT_EQUAL_INT(64, raycaster->lighting->levels[i]);
+    }
+
+    // Doors are lit on their panel and, once marked open, let the light through
+    RaycastRect     door       = { 6, 4, 1, 1 };
+    RaycastRect     target     = { 9, 4, 1, 1 };
+    RaycastThinWall panel      = { 0, 0.5f, RAYCAST_THIN_VERTICAL, 0.0f };
+    RaycastLight    lamp       = { 4.5f, 4.5f, 6.0f, 100 };
+    int             panelWest  = (4 * 16 + 6) * 4 + RAYCAST_FACE_WEST;
+    int             targetWest = (4 * 16 + 9) * 4 + RAYCAST_FACE_WEST;
+    raycast_draw(raycaster, &door, &id);
+    raycast_draw(raycaster, &target, &id);
+    TEST_ASSERT_EQUAL_INT(0, raycast_set_thin_wall(raycaster, 6, 4, &panel));
+    TEST_ASSERT_EQUAL_INT(0, raycast_lightmap_add_light(lightmap, &lamp));
+    TEST_ASSERT_EQUAL_INT(0, raycast_lightmap_update(lightmap, pool));
+    TEST_ASSERT_EQUAL_INT(64 + 66, raycaster->lighting->levels[panelWest]);
+    TEST_ASSERT_EQUAL_INT(64, raycaster->lighting->levels[targetWest]);
+    raycast_get_thin_wall(raycaster, 6, 4)->open = 1.0f;
+    raycast_mark_cell(raycaster, 6, 4);
+    TEST_ASSERT_EQUAL_INT(0, raycast_lightmap_update(lightmap, pool));
+    TEST_ASSERT_EQUAL_INT(64, raycaster->lighting->levels[panelWest]);
+    TEST_ASSERT_EQUAL_INT(64 + 25, raycaster->lighting->levels[targetWest]);
+
+    // Snapshot views do not share the levels the writer keeps relighting
+    RaycastSnapshots* snapshots = raycast_snapshots_create(raycaster, 1);
+    TEST_ASSERT_NOT_NULL(snapshots);
+    TEST_ASSERT_NULL(raycast_snapshot_acquire(snapshots, 0)->lighting);
+    raycast_snapshot_release(snapshots, 0);
+    raycast_snapshots_destroy(snapshots);
+
+    raycast_lightmap_destroy(lightmap);
+    raycast_thread_pool_destroy(pool);
+}
+
+void test_raycast_render_geometry(void) {
+    RaycastColor  wall    = 0xFF00FF00;
+    RaycastColor  pillar  = 0xFFC04020;
+    RaycastColor  bg      = 0xFF101010;
+    RaycastRect   all     = { 0, 0, 16, 16 };
+    RaycastRect   inner   = { 1, 1, 14, 14 };
+    RaycastRect   block   = { 9, 5, 2, 2 };
+    RaycastCamera camera  = { 3.5f, 4.5f, 1.0f, 0.3f, 0.0f, 0.66f, 90 };
+    SDL_Surface*  batched = SDL_CreateSurface(64, 48, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Surface*  columns = SDL_CreateSurface(64, 48, SDL_PIXELFORMAT_ARGB8888);
+    TEST_ASSERT_NOT_NULL(batched);
+    TEST_ASSERT_NOT_NULL(columns);
+    SDL_Renderer* renderer  = SDL_CreateSoftwareRenderer(batched);
+    SDL_Renderer* reference = SDL_CreateSoftwareRenderer(columns);
+    TEST_ASSERT_NOT_NULL(renderer);
+    TEST_ASSERT_NOT_NULL(reference);
+
+    INIT(16, 16);
+    raycast_draw(raycaster, &all, &wall);
+    raycast_erase(raycaster, &inner);
+    raycast_draw(raycaster, &block, &pillar);
+
+    // A narrower frame first, so the renderer's scratch has to grow for the second one
+    raycast_render(raycaster, &camera, renderer, 32, 48, &bg);
+    raycast_render(raycaster, &camera, renderer, 64, 48, &bg);
+    SDL_FlushRenderer(renderer);
+
+    // The per-column output the batch replaces: background, wall slice, background
+    float direction = atan2f(camera.dirY, camera.dirX) * (180.0f / M_PI);
+    for (int x = 0; x < 64; x++) {
+        RaycastColor color    = RAYCAST_EMPTY;
+        float        angle    = direction - (camera.fov / 2.0f) + (camera.fov * x) / 64;
+        float        distance = raycast_cast(raycaster, camera.posX, camera.posY, angle, &color);
+        int          height   = (distance > 0.0f) ? (int) (48 / (distance + 0.0001f)) : 0;
+        int          top      = (48 - height) / 2;
+        raycast_set_draw_color(reference, &bg);
+        SDL_RenderLine(reference, x, 0, x, top);
+        raycast_set_draw_color(reference, (color == RAYCAST_EMPTY) ? &bg : &color);
+        SDL_RenderLine(reference, x, top, x, top + height);
+        raycast_set_draw_color(reference, &bg);
+        SDL_RenderLine(reference, x, top + height, x, 48);
+    }
+    SDL_FlushRenderer(reference);
+
+    TEST_ASSERT_TRUE(SDL_LockSurface(batched));
+    TEST_ASSERT_TRUE(SDL_LockSurface(columns));
+    for (int y = 0; y < 48; y++) {
+        TEST_ASSERT_EQUAL_MEMORY((const uint8_t*) columns->pixels + y * columns->pitch,
+                                 (const uint8_t*) batched->pixels + y * batched->pitch,
+                                 64 * 4);
+    }
+    SDL_UnlockSurface(columns);
+    SDL_UnlockSurface(batched);
+
+    SDL_DestroyRenderer(reference);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroySurface(columns);
+    SDL_DestroySurface(batched);
+}